@@ -0,0 +1,41 @@
+#
+# Copyright 2022 Toyota Connected North America
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+
+# ==================================================================================================
+# Symbol check
+# ==================================================================================================
+#
+# Run with cmake -P after a link. Fails if the binary FILE defines any symbol whose demangled name
+# matches the regular expression PATTERN, e.g. to make sure a library was left out.
+#
+#   cmake -DNM=<nm> -DFILE=<binary> -DPATTERN=<regex> -P check_symbols.cmake
+#
+
+execute_process(
+        COMMAND ${NM} -C --defined-only ${FILE}
+        OUTPUT_VARIABLE symbols
+        ERROR_VARIABLE error
+        RESULT_VARIABLE result
+)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Unable to list the symbols of ${FILE}: ${error}")
+endif ()
+
+string(REGEX MATCH "[^\n]*(${PATTERN})[^\n]*" match "${symbols}")
+if (match)
+    message(FATAL_ERROR "${FILE} defines symbols matching ${PATTERN}, e.g.\n${match}")
+endif ()
@@ -18,7 +18,49 @@
 # Compiler flags
 # ==================================================================================================
 
-add_compile_definitions(FILAMENT_SINGLE_THREADED)
+if (FILAMENT_SINGLE_THREADED)
+    add_compile_definitions(FILAMENT_SINGLE_THREADED)
+endif ()
+
+if (NOT COMP_SURF_DEBUG_VIEWS)
+    add_compile_definitions(FILAMENTAPP_DEBUG_VIEWS=0)
+endif ()
+
+if (COMP_SURF_PRECOMPILED_GLTF_MATERIALS)
+    add_compile_definitions(FILAMENTAPP_PRECOMPILED_GLTF_MATERIALS=1)
+endif ()
+
+if (NOT COMP_SURF_RUNTIME_MATERIALS)
+    add_compile_definitions(FILAMENTAPP_RUNTIME_MATERIALS=0)
+endif ()
+
+if (COMP_SURF_VULKAN_PIPELINE_CACHE)
+    add_compile_definitions(FILAMENTAPP_VULKAN_PIPELINE_CACHE=1)
+endif ()
+
+#
+# Filament revision, part of the material cache tag. Materials built by another filament may not
+# load even when MATERIAL_VERSION didn't change. Taken from the submodule's commit, or the release
+# version if it isn't a git checkout; reconfigure after updating the submodule.
+#
+execute_process(
+        COMMAND git rev-parse --short=12 HEAD
+        WORKING_DIRECTORY ${CMAKE_SOURCE_DIR}/third_party/filament
+        OUTPUT_VARIABLE FILAMENT_BUILD_ID
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+        ERROR_QUIET
+        RESULT_VARIABLE FILAMENT_BUILD_ID_RESULT
+)
+if (NOT FILAMENT_BUILD_ID_RESULT EQUAL 0 OR NOT FILAMENT_BUILD_ID)
+    file(STRINGS ${CMAKE_SOURCE_DIR}/third_party/filament/android/gradle.properties FILAMENT_BUILD_ID
+            REGEX "^VERSION_NAME=")
+    string(REPLACE "VERSION_NAME=" "" FILAMENT_BUILD_ID "${FILAMENT_BUILD_ID}")
+endif ()
+if (NOT FILAMENT_BUILD_ID)
+    set(FILAMENT_BUILD_ID unknown)
+endif ()
+message(STATUS "Filament build id ...... ${FILAMENT_BUILD_ID}")
+add_compile_definitions(FILAMENT_BUILD_ID="${FILAMENT_BUILD_ID}")
 
 #string(APPEND CMAKE_CXX_FLAGS " -fno-rtti")
 
@@ -0,0 +1,247 @@
+#
+# Copyright 2022 Toyota Connected North America
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# ==================================================================================================
+# Precompiled glTF material variants
+# ==================================================================================================
+#
+# Writes one .mat file per glTF MaterialConfig variant so matc can compile them at build time
+# instead of filamat at runtime. The material generated here must stay in sync with
+# shaderFromConfig() and compileMaterial() in MeshAssimp.cpp, and the variant index with
+# gltfVariantIndex():
+#
+#   bits 0-4   map sampled from UV1 instead of UV0: normal, baseColor, metallicRoughness, ao, emissive
+#   bit  5     double sided
+#   bit  6     unlit
+#   bits 7-8   alpha mode: opaque, masked, transparent
+#   bits 9-13  map present, same order as bits 0-4
+#
+# Missing maps get no sampler and their UV bit is clear. Unlit materials only use the baseColor map.
+#
+# Masked variants default to the glTF alpha cutoff of 0.5, instances set the actual one.
+#
+
+if (CMAKE_VERSION VERSION_LESS 3.18)
+    message(FATAL_ERROR "Precompiled glTF materials need CMake 3.18 or newer for file(CONFIGURE)")
+endif ()
+
+# the generator itself, part of the stamp below
+set(GLTF_MATERIALS_GENERATOR ${CMAKE_CURRENT_LIST_FILE})
+
+set(GLTF_MATERIAL_ALPHA_MODES opaque masked transparent)
+
+set(GLTF_MATERIAL_MAPS normal baseColor metallicRoughness ao emissive)
+
+function(gltf_material_shader uv_mask map_mask unlit alpha_mode OUT)
+    set(shader "void material(inout MaterialInputs material) {\n")
+    set(bit 0)
+    foreach (name ${GLTF_MATERIAL_MAPS})
+        math(EXPR has_map "(${map_mask} >> ${bit}) & 1")
+        math(EXPR uv "(${uv_mask} >> ${bit}) & 1")
+        set(has_${name} ${has_map})
+        if (has_map)
+            string(APPEND shader "    float2 ${name}UV = getUV${uv}();\n")
+        endif ()
+        math(EXPR bit "${bit} + 1")
+    endforeach ()
+
+    if (NOT unlit AND has_normal)
+        string(APPEND shader
+                "    material.normal = texture(materialParams_normalMap, normalUV).xyz * 2.0 - 1.0;\n"
+                "    material.normal.y = -material.normal.y;\n")
+    endif ()
+
+    string(APPEND shader
+            "    prepareMaterial(material);\n"
+            "    material.baseColor = materialParams.baseColorFactor;\n")
+    if (has_baseColor)
+        string(APPEND shader "    material.baseColor *= texture(materialParams_baseColorMap, baseColorUV);\n")
+    endif ()
+
+    if (alpha_mode STREQUAL "transparent")
+        string(APPEND shader "    material.baseColor.rgb *= material.baseColor.a;\n")
+    endif ()
+
+    if (NOT unlit)
+        string(APPEND shader
+                "    material.roughness = materialParams.roughnessFactor;\n"
+                "    material.metallic = materialParams.metallicFactor;\n"
+                "    material.emissive.rgb = materialParams.emissiveFactor.rgb;\n"
+                "    material.emissive.a = 0.0;\n")
+        if (has_metallicRoughness)
+            string(APPEND shader
+                    "    vec4 metallicRoughness = texture(materialParams_metallicRoughnessMap, metallicRoughnessUV);\n"
+                    "    material.roughness *= metallicRoughness.g;\n"
+                    "    material.metallic *= metallicRoughness.b;\n")
+        endif ()
+        if (has_ao)
+            string(APPEND shader "    material.ambientOcclusion = texture(materialParams_aoMap, aoUV).r;\n")
+        endif ()
+        if (has_emissive)
+            string(APPEND shader "    material.emissive.rgb *= texture(materialParams_emissiveMap, emissiveUV).rgb;\n")
+        endif ()
+    endif ()
+
+    string(APPEND shader "}\n")
+    set(${OUT} "${shader}" PARENT_SCOPE)
+endfunction()
+
+function(gltf_material_definition name uv_mask map_mask double_sided unlit alpha_mode OUT)
+    set(requires "uv0")
+    if (uv_mask)
+        set(requires "uv0, uv1")
+    endif ()
+    if (unlit)
+        set(shading unlit)
+    else ()
+        set(shading lit)
+    endif ()
+    if (double_sided)
+        set(double_sided true)
+    else ()
+        set(double_sided false)
+    endif ()
+
+    set(params)
+    foreach (param
+            "float4 baseColorFactor" "float metallicFactor" "float roughnessFactor"
+            "float normalScale" "float aoStrength" "float3 emissiveFactor")
+        string(REPLACE " " ";" param "${param}")
+        list(GET param 0 type)
+        list(GET param 1 param_name)
+        list(APPEND params "        { type : ${type}, name : ${param_name} }")
+    endforeach ()
+    # same order as compileMaterial()
+    foreach (map baseColor metallicRoughness ao emissive normal)
+        list(FIND GLTF_MATERIAL_MAPS ${map} bit)
+        math(EXPR has_map "(${map_mask} >> ${bit}) & 1")
+        if (has_map)
+            list(APPEND params "        { type : sampler2d, name : ${map}Map }")
+        endif ()
+    endforeach ()
+    string(REPLACE ";" ",\n" params "${params}")
+
+    set(mask_threshold)
+    if (alpha_mode STREQUAL "masked")
+        set(mask_threshold "    maskThreshold : 0.5,\n")
+    endif ()
+
+    gltf_material_shader(${uv_mask} ${map_mask} "${unlit}" ${alpha_mode} shader)
+
+    string(CONCAT definition
+            "material {\n"
+            "    name : ${name},\n"
+            "    requires : [ ${requires} ],\n"
+            "    shadingModel : ${shading},\n"
+            "    blending : ${alpha_mode},\n"
+            "${mask_threshold}"
+            "    doubleSided : ${double_sided},\n"
+            "    parameters : [\n${params}\n    ]\n"
+            "}\n\n"
+            "fragment {\n${shader}}\n")
+    set(${OUT} "${definition}" PARENT_SCOPE)
+endfunction()
+
+#
+# Generates the variants into OUTPUT_DIR. UV_SETS is 1 to only build materials sampling UV0
+# (204 variants) or 2 to also cover every combination of maps on UV1 (1476 variants).
+# GENERATOR_VERSION is kMaterialGeneratorVersion from MeshAssimp.cpp.
+#
+# OUT_SRCS receives the .mat files. TABLE is written with one
+#   { index, PACKAGE_GLTF_V<index>_DATA, PACKAGE_GLTF_V<index>_SIZE },
+# initializer per variant, for the resgen package named PACKAGE.
+#
+# Editing this file reruns the configure step. When this file, GENERATOR_VERSION or UV_SETS
+# changed since the variants were last generated, all of them are removed and written anew, so
+# that every variant is recompiled and none that is no longer generated lingers.
+#
+function(generate_gltf_materials OUTPUT_DIR UV_SETS GENERATOR_VERSION PACKAGE TABLE OUT_SRCS)
+    if (NOT UV_SETS MATCHES "^[12]$")
+        message(FATAL_ERROR "COMP_SURF_GLTF_MATERIAL_UV_SETS must be 1 or 2, not ${UV_SETS}")
+    endif ()
+    file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${GLTF_MATERIALS_GENERATOR})
+    file(READ ${GLTF_MATERIALS_GENERATOR} generator)
+    string(SHA1 stamp "${generator}\n${GENERATOR_VERSION}\n${UV_SETS}")
+    set(stamp_file ${OUTPUT_DIR}/generator.stamp)
+    set(previous_stamp)
+    if (EXISTS ${stamp_file})
+        file(READ ${stamp_file} previous_stamp)
+    endif ()
+    if (NOT previous_stamp STREQUAL stamp)
+        file(GLOB stale ${OUTPUT_DIR}/*.mat)
+        if (stale)
+            file(REMOVE ${stale})
+        endif ()
+    endif ()
+    string(TOUPPER ${PACKAGE} package_upper)
+
+    set(srcs)
+    set(table "// Generated by cmake/gltf_materials.cmake, do not edit.\n")
+    set(alpha_index 0)
+    foreach (alpha_mode ${GLTF_MATERIAL_ALPHA_MODES})
+        foreach (unlit 0 1)
+            if (unlit)
+                set(map_masks 0 2)
+            else ()
+                set(map_masks)
+                foreach (map_mask RANGE 31)
+                    list(APPEND map_masks ${map_mask})
+                endforeach ()
+            endif ()
+
+            foreach (double_sided 0 1)
+                foreach (map_mask ${map_masks})
+                    # every subset of the present maps may be on UV1
+                    set(uv_masks 0)
+                    if (UV_SETS EQUAL 2)
+                        foreach (uv_mask RANGE 1 31)
+                            math(EXPR outside "${uv_mask} & ~${map_mask}")
+                            if (outside EQUAL 0)
+                                list(APPEND uv_masks ${uv_mask})
+                            endif ()
+                        endforeach ()
+                    endif ()
+
+                    foreach (uv_mask ${uv_masks})
+                        math(EXPR index "${uv_mask} | (${double_sided} << 5) | (${unlit} << 6) | (${alpha_index} << 7) | (${map_mask} << 9)")
+                        # zero padded so resgen symbols and file names sort by index
+                        string(LENGTH "${index}" digits)
+                        math(EXPR padding "5 - ${digits}")
+                        string(REPEAT "0" ${padding} zeros)
+                        set(name "gltf_v${zeros}${index}")
+
+                        gltf_material_definition(${name} ${uv_mask} ${map_mask} ${double_sided} ${unlit}
+                                ${alpha_mode} content)
+                        # only rewritten when the content changes so matc doesn't rerun on every configure
+                        file(CONFIGURE OUTPUT ${OUTPUT_DIR}/${name}.mat CONTENT "${content}" @ONLY)
+                        list(APPEND srcs ${OUTPUT_DIR}/${name}.mat)
+
+                        string(TOUPPER ${name} name_upper)
+                        string(APPEND table
+                                "{ ${index}, ${package_upper}_${name_upper}_DATA, ${package_upper}_${name_upper}_SIZE },\n")
+                    endforeach ()
+                endforeach ()
+            endforeach ()
+        endforeach ()
+        math(EXPR alpha_index "${alpha_index} + 1")
+    endforeach ()
+
+    file(CONFIGURE OUTPUT ${TABLE} CONTENT "${table}" @ONLY)
+    file(WRITE ${stamp_file} "${stamp}")
+    set(${OUT_SRCS} ${srcs} PARENT_SCOPE)
+endfunction()
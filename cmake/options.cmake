@@ -32,6 +32,73 @@ set(FILAMENT_SUPPORTS_METAL OFF)
 set(FILAMENT_USE_SWIFTSHADER OFF)
 set(FILAMENT_ENABLE_MATDBG OFF)
 
+#
+# Threading
+#
+# OFF: filament runs its driver on a thread of its own and the job system has
+#      worker threads. comp_surf_draw_frame only records commands, the GPU work
+#      is submitted and presented by the driver thread.
+# ON:  everything runs on the thread calling comp_surf_*; draw_frame executes
+#      the command stream itself.
+#
+# This is compiled into filament (UTILS_HAS_THREADING), so it can't be changed
+# at runtime.
+#
+option(FILAMENT_SINGLE_THREADED "Run the filament driver on the calling thread" OFF)
+message(STATUS "Single threaded ........ ${FILAMENT_SINGLE_THREADED}")
+
+#
+# Debug views
+#
+# ON:  the split view debug apparatus (debug and ortho cameras, frustum cubes,
+#      depth and transparent materials) is built and can be turned off per
+#      context with Config::debugViews.
+# OFF: production profile, all of it is compiled out.
+#
+option(COMP_SURF_DEBUG_VIEWS "Build the split view debug cameras, frustum cubes and materials" ON)
+message(STATUS "Debug views ............ ${COMP_SURF_DEBUG_VIEWS}")
+
+#
+# glTF materials
+#
+# Every distinct glTF material configuration needs a material of its own.
+# COMP_SURF_PRECOMPILED_GLTF_MATERIALS compiles the variants with matc at build
+# time, COMP_SURF_GLTF_MATERIAL_UV_SETS picks whether only materials sampling
+# UV0 (1, 204 variants) or also every combination of maps on UV1 (2, 1476
+# variants) are built.
+#
+# The variants are only worth their build time and size for apps loading glTF
+# through MeshAssimp; the plugin's own scene doesn't, so this is OFF by
+# default.
+#
+# COMP_SURF_RUNTIME_MATERIALS keeps filamat, and with it glslang, to compile
+# the configurations that weren't precompiled. Without it those fall back to
+# the closest precompiled variant, which makes for a much smaller production
+# build; the plugin's link then fails if filamat or glslang symbols still end
+# up in it.
+#
+option(COMP_SURF_PRECOMPILED_GLTF_MATERIALS "Compile the glTF material variants at build time" OFF)
+set(COMP_SURF_GLTF_MATERIAL_UV_SETS "1" CACHE STRING "UV sets covered by the precompiled glTF materials, 1 or 2")
+option(COMP_SURF_RUNTIME_MATERIALS "Compile missing glTF materials at runtime with filamat" ON)
+message(STATUS "Precompiled materials .. ${COMP_SURF_PRECOMPILED_GLTF_MATERIALS} (UV sets: ${COMP_SURF_GLTF_MATERIAL_UV_SETS})")
+message(STATUS "Runtime materials ...... ${COMP_SURF_RUNTIME_MATERIALS}")
+
+if (NOT COMP_SURF_PRECOMPILED_GLTF_MATERIALS AND NOT COMP_SURF_RUNTIME_MATERIALS)
+    message(FATAL_ERROR "glTF materials need COMP_SURF_PRECOMPILED_GLTF_MATERIALS or COMP_SURF_RUNTIME_MATERIALS")
+endif ()
+
+#
+# Vulkan pipeline cache
+#
+# ON:  the Vulkan backend keeps its VkPipelineCache in <cachePath>/pipelines.
+#      Needs third_party/0004-Vulkan-pipeline-cache.patch applied to filament,
+#      which adds backend::setPipelineCacheDirectory().
+# OFF: pipelines are compiled without a persistent cache, builds against an
+#      unpatched filament.
+#
+option(COMP_SURF_VULKAN_PIPELINE_CACHE "Persist the Vulkan pipeline cache, needs the 0004 filament patch" OFF)
+message(STATUS "Pipeline cache ......... ${COMP_SURF_VULKAN_PIPELINE_CACHE}")
+
 
 # Target system.
 if (IS_MOBILE_TARGET)
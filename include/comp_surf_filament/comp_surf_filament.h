@@ -30,6 +30,93 @@ extern "C" {
 
 typedef struct comp_surf_Context comp_surf_Context;
 
+#define COMP_SURF_STATS_VERSION 5
+
+/*
+ * Filled in by comp_surf_get_stats. The caller sets version to the
+ * COMP_SURF_STATS_VERSION it was built against; fields are only ever appended,
+ * so older callers keep working with newer libraries. Byte counts are process
+ * wide estimates, the engine and its resources are shared between contexts.
+ */
+typedef struct comp_surf_Stats {
+  uint32_t version;
+
+  /* frame counters */
+  uint64_t framesRendered;
+  uint64_t framesSkipped; /* the renderer refused the frame (beginFrame) */
+  uint64_t framesIdle;    /* nothing changed, previous buffer still valid */
+  uint64_t framesEarly;   /* requested faster than the display refresh */
+  uint64_t swapchainRecreations;
+
+  /* CPU time spent in comp_surf_draw_frame for rendered frames */
+  float lastFrameMs;
+  float p50FrameMs;
+  float p95FrameMs;
+  float p99FrameMs;
+
+  /* scene content */
+  uint32_t entityCount;
+  uint32_t renderableCount;
+  uint32_t drawCount; /* primitives rendered by all views, before culling */
+
+  /* memory held by resources */
+  int64_t meshCpuBytes;
+  int64_t meshGpuBytes;
+  int64_t textureCpuBytes;
+  int64_t textureGpuBytes;
+  int64_t materialCpuBytes;
+  int64_t materialGpuBytes;
+
+  /* version 2: frame pacing, see comp_surf_set_max_frame_rate */
+  uint64_t framesPaced; /* declined to honor the frame rate cap */
+  float targetFrameMs;  /* time between frames the pacer aims for */
+
+  /* version 3: see comp_surf_set_performance_governor */
+  uint32_t qualityLevel; /* 0 is full quality, higher levels cost less */
+  float temperature;     /* Celsius, 0 unless a thermal limit is set */
+
+  /* version 4: parallel scene update of the last rendered frame */
+  float updateMs;         /* wall time from the first job to the join */
+  float animationJobMs;   /* CPU time summed over the animation jobs */
+  float manipulatorJobMs; /* CPU time summed over the camera manipulator jobs */
+  uint32_t updateJobCount;
+
+  /* version 5: see comp_surf_set_frames_in_flight */
+  uint64_t framesThrottled; /* no frame in flight completed in time */
+} comp_surf_Stats;
+
+/* Frame phases with a duration histogram, see comp_surf_get_phase_timing. */
+typedef enum comp_surf_FramePhase {
+  COMP_SURF_PHASE_FRAME = 0,      /* whole comp_surf_draw_frame that rendered */
+  COMP_SURF_PHASE_EXECUTE,        /* engine execute, single threaded builds */
+  COMP_SURF_PHASE_UPDATE,         /* wall time of the parallel scene update */
+  COMP_SURF_PHASE_ANIMATION,      /* CPU time, summed over parallel jobs */
+  COMP_SURF_PHASE_MANIPULATORS,   /* CPU time, summed over parallel jobs */
+  COMP_SURF_PHASE_FRUSTUM,        /* frustum visualization */
+  COMP_SURF_PHASE_OFFSCREEN_VIEWS,
+  COMP_SURF_PHASE_VIEW_0,         /* render of each window view, in order */
+  COMP_SURF_PHASE_VIEW_1,
+  COMP_SURF_PHASE_VIEW_2,
+  COMP_SURF_PHASE_VIEW_3,
+  COMP_SURF_PHASE_END_FRAME,
+  COMP_SURF_PHASE_COUNT
+} comp_surf_FramePhase;
+
+/*
+ * Summary of one phase's histogram since the last reset. Percentiles come
+ * from logarithmic buckets and are accurate to about 20%, min and max are
+ * exact. All zero while the phase has no samples.
+ */
+typedef struct comp_surf_PhaseTiming {
+  uint64_t count;
+  float minMs;
+  float maxMs;
+  float meanMs;
+  float p50Ms;
+  float p95Ms;
+  float p99Ms;
+} comp_surf_PhaseTiming;
+
 // #############################################################################
 //  ivi-homescreen API
 // #############################################################################
@@ -38,9 +125,32 @@ uint32_t comp_surf_version();
 
 typedef const void* (*comp_surf_LoaderFunction)(void* userdata,
                                                 char const* procname);
+
+/*
+ * Vulkan is dispatched through the vkGetInstanceProcAddr returned by
+ * loaderFunction, so the plugin shares the host's loader, ICDs and layers.
+ * Must be called before the first comp_surf_initialize; without it (or if the
+ * loader doesn't resolve vkGetInstanceProcAddr) libvulkan is loaded directly.
+ */
 void comp_surf_load_functions(void* userdata,
                               comp_surf_LoaderFunction loaderFunction);
 
+/*
+ * Starts recording timed events (frame phases, model import, IBL prefilter,
+ * material builds) into a ring of eventCapacity events, process wide; the
+ * oldest events are overwritten once it is full. 0 stops recording. Call it
+ * before comp_surf_initialize to include loading.
+ */
+void comp_surf_set_tracing(uint32_t eventCapacity);
+
+/*
+ * Writes the recorded events as Chrome trace JSON (chrome://tracing,
+ * ui.perfetto.dev) to fileName in the context's miscPath, or to
+ * comp_surf_trace.json if fileName is NULL. comp_surf_de_initialize does this
+ * automatically while recording. Returns 0 on success.
+ */
+int comp_surf_write_trace(comp_surf_Context* ctx, const char* fileName);
+
 comp_surf_Context* comp_surf_initialize(const char* accessToken,
                                         int width,
                                         int height,
@@ -49,14 +159,177 @@ comp_surf_Context* comp_surf_initialize(const char* accessToken,
                                         const char* cachePath,
                                         const char* miscPath);
 
+typedef void (*comp_surf_ReadyCallback)(void* userdata, comp_surf_Context* ctx);
+
+/*
+ * Non-blocking variant of comp_surf_initialize. Returns immediately; the IBL
+ * files are read and parsed on a worker thread and the remaining setup is
+ * spread over subsequent comp_surf_run_task calls. comp_surf_draw_frame is a
+ * no-op until the context is ready. The callback is invoked from
+ * comp_surf_run_task(_budget) on the calling thread once the context is ready,
+ * and may be NULL.
+ *
+ * The setup runs as whole stages on the thread calling comp_surf_run_task, a
+ * budget can't split them: engine creation (first context of the process),
+ * window and swap chain creation, the IBL texture upload, and the scene setup
+ * (material build and mesh load). Expect a call running one of these to take
+ * as long as the stage does, whatever its budget.
+ */
+comp_surf_Context* comp_surf_initialize_async(const char* accessToken,
+                                              int width,
+                                              int height,
+                                              void* nativeWindow,
+                                              const char* assetsPath,
+                                              const char* cachePath,
+                                              const char* miscPath,
+                                              comp_surf_ReadyCallback callback,
+                                              void* userdata);
+
+typedef void (*comp_surf_FrameCallback)(void* userdata,
+                                        comp_surf_Context* ctx,
+                                        uint32_t bufferIndex,
+                                        const void* pixels,
+                                        uint32_t width,
+                                        uint32_t height,
+                                        uint32_t stride);
+
+/*
+ * Renders to memory instead of a window. Each rendered frame is read back
+ * asynchronously into one of bufferCount (1-8) buffers; the readback of a
+ * frame overlaps rendering of the next one. When a readback completes the
+ * callback receives a pointer into the buffer, not a copy, from within a later
+ * comp_surf_draw_frame. The buffer stays valid and untouched until returned
+ * with comp_surf_release_frame. Frames are dropped while no buffer is free.
+ * Pixels are RGBA8, rows ordered bottom to top.
+ */
+comp_surf_Context* comp_surf_initialize_headless(const char* accessToken,
+                                                 int width,
+                                                 int height,
+                                                 const char* assetsPath,
+                                                 const char* cachePath,
+                                                 const char* miscPath,
+                                                 uint32_t bufferCount,
+                                                 comp_surf_FrameCallback callback,
+                                                 void* userdata);
+
+/*
+ * Reads the duration histogram of a frame phase. Returns 0 on success, -1 if
+ * phase is out of range. Lock free, any thread.
+ */
+int comp_surf_get_phase_timing(comp_surf_Context* ctx,
+                               comp_surf_FramePhase phase,
+                               comp_surf_PhaseTiming* timing);
+
+/* Clears the histograms of all phases. Lock free, any thread. */
+void comp_surf_reset_phase_timings(comp_surf_Context* ctx);
+
+/* Returns a buffer received by the comp_surf_FrameCallback. Any thread. */
+void comp_surf_release_frame(comp_surf_Context* ctx, uint32_t bufferIndex);
+
+/* Returns non-zero once the context has finished loading. */
+int comp_surf_is_ready(comp_surf_Context* ctx);
+
+/*
+ * Blocks until the driver has released the context's swap chain, the native
+ * window may be destroyed as soon as this returns. The engine itself is shut
+ * down with the last context, on the thread calling this.
+ */
 void comp_surf_de_initialize(comp_surf_Context* ctx);
 
 void comp_surf_run_task(comp_surf_Context* ctx);
 
+/*
+ * Runs queued background work (loading stages, uploads, cache writes) until
+ * budgetUs microseconds are used up. A work item that has started always
+ * finishes its step, so a call can overrun the budget by one step; loading
+ * stages are single steps, see comp_surf_initialize_async. At least one step
+ * runs per call. Returns the number of work items still pending.
+ * comp_surf_run_task is equivalent to calling this with a 2 ms budget.
+ */
+uint32_t comp_surf_run_task_budget(comp_surf_Context* ctx, uint32_t budgetUs);
+
+/*
+ * time is the host's presentation timestamp in milliseconds. It is the only
+ * clock used for animation and camera updates, so replaying the same
+ * timestamps reproduces the same frames.
+ */
 void comp_surf_draw_frame(comp_surf_Context* ctx, uint32_t time);
 
+/*
+ * Returns non-zero if the last comp_surf_draw_frame submitted a new buffer.
+ * Frames whose scene, camera and viewport did not change are not rendered,
+ * the previously presented buffer stays valid.
+ */
+int comp_surf_frame_submitted(comp_surf_Context* ctx);
+
+/*
+ * Sets the display refresh rate used to predict the next vblank (0 estimates
+ * it from the frame timestamps). With predictNextVsync set, animation is
+ * evaluated at the predicted presentation time instead of the frame's
+ * timestamp.
+ */
+void comp_surf_set_frame_timing(comp_surf_Context* ctx,
+                                float refreshRateHz,
+                                int predictNextVsync);
+
+typedef enum comp_surf_PipelineMode {
+  /* wait for the oldest frame before sampling inputs for a new one */
+  COMP_SURF_PIPELINE_LOW_LATENCY = 0,
+  /* update the scene first, wait for the oldest frame before submitting */
+  COMP_SURF_PIPELINE_HIGH_THROUGHPUT = 1,
+} comp_surf_PipelineMode;
+
+/*
+ * Caps the frame rate. Frames are rendered every round(refresh / fps) display
+ * refreshes, comp_surf_draw_frame calls in between return without rendering.
+ * The display rate is estimated from the draw_frame timestamps, or seeded
+ * with comp_surf_set_frame_timing. 0 removes the cap.
+ */
+void comp_surf_set_max_frame_rate(comp_surf_Context* ctx, float fps);
+
+/*
+ * Lets the context lower its rendering quality while frames don't fit the
+ * target frame time (one refresh, or the comp_surf_set_max_frame_rate cap)
+ * and raise it again once they comfortably do. In order the levels enable
+ * dynamic resolution, replace MSAA with FXAA, then turn off SSAO, bloom,
+ * high resolution shadow maps and screen space contact shadows. With a
+ * non-zero thermalLimitCelsius, the hottest /sys/class/thermal zone reaching
+ * it counts as being over budget. Disabling restores the original settings.
+ */
+void comp_surf_set_performance_governor(comp_surf_Context* ctx,
+                                        int enabled,
+                                        float thermalLimitCelsius);
+
+/*
+ * Bounds the number of frames submitted but not yet completed by the GPU to
+ * framesInFlight (1-3). 1 in low latency mode gives the shortest input to
+ * display delay, 3 in high throughput mode the steadiest frame rate. 0 (the
+ * default) leaves frame pacing to filament. A frame is dropped when no frame
+ * in flight completes within a display refresh, these are reported as
+ * framesThrottled in comp_surf_Stats.
+ */
+void comp_surf_set_frames_in_flight(comp_surf_Context* ctx,
+                                    comp_surf_PipelineMode mode,
+                                    uint32_t framesInFlight);
+
+/*
+ * Resizes are coalesced: the swap chain, viewports and camera projections are
+ * updated once, at the start of the next comp_surf_draw_frame. Unless built
+ * with FILAMENT_SINGLE_THREADED the swap chain is rebuilt on filament's driver
+ * thread, frames already in flight are still presented at the old size.
+ */
 void comp_surf_resize(comp_surf_Context* ctx, int width, int height);
 
+/* Number of times the swap chain was recreated because of a resize. */
+uint32_t comp_surf_get_swapchain_recreation_count(comp_surf_Context* ctx);
+
+/*
+ * Copies the statistics published by the last comp_surf_draw_frame. Doesn't
+ * block and may be called from any thread while frames are being drawn.
+ * Returns 0 on success, -1 if stats->version is not supported.
+ */
+int comp_surf_get_stats(comp_surf_Context* ctx, comp_surf_Stats* stats);
+
 // #############################################################################
 //  services API
 // #############################################################################
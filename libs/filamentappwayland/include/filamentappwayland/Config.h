@@ -23,21 +23,35 @@
 
 #include <camutils/Manipulator.h>
 
+// Build with FILAMENTAPP_DEBUG_VIEWS=0 to compile out the split view debug apparatus, see
+// Config::debugViews.
+#ifndef FILAMENTAPP_DEBUG_VIEWS
+#define FILAMENTAPP_DEBUG_VIEWS 1
+#endif
+
 struct Config {
+    static constexpr bool kDebugViewsSupported = FILAMENTAPP_DEBUG_VIEWS != 0;
+
     std::string title;
     std::string iblDirectory;
     std::string dirt;
     std::string assetPath;
+    std::string cachePath;      // persistent, writable; empty disables on-disk caches
     int width;
     int height;
     float scale = 1.0f;
     bool splitView = false;
+    // Debug and ortho cameras, the debug manipulator, the frustum cubes and the depth, default and
+    // transparent materials. Without them splitView is ignored.
+    bool debugViews = kDebugViewsSupported;
     mutable filament::Engine::Backend backend = filament::Engine::Backend::VULKAN;
     mutable filament::backend::FeatureLevel featureLevel = filament::backend::FeatureLevel::FEATURE_LEVEL_3;
     filament::camutils::Mode cameraMode = filament::camutils::Mode::ORBIT;
     bool resizeable = true;
     bool headless = false;
     void *native_window;
+
+    [[nodiscard]] bool hasDebugViews() const { return kDebugViewsSupported && debugViews; }
 };
 
 #endif // TNT_FILAMENT_SAMPLE_CONFIG_H
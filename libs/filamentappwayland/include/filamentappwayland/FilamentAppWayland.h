@@ -19,6 +19,7 @@
 
 #include <chrono>
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -29,12 +30,25 @@
 
 #include <camutils/Manipulator.h>
 
+#include <math/vec3.h>
+
 #include <utils/Path.h>
 #include <utils/Entity.h>
 
 #include "Config.h"
 #include "IBL.h"
 #include "Cube.h"
+#include "FrameClock.h"
+#include "FramePacer.h"
+#include "FramePipeline.h"
+#include "FrameStats.h"
+#include "GpuTimer.h"
+#include "PerformanceGovernor.h"
+#include "PhaseTimings.h"
+#include "ReadbackRing.h"
+#include "SharedEngine.h"
+#include "TaskQueue.h"
+#include "TransformAnimator.h"
 #include "Timer.hpp"
 
 namespace filament {
@@ -66,32 +80,91 @@ public:
     using AnimCallback = std::function<void(void *data, filament::Engine *, filament::View *, double now)>;
     using ResizeCallback = std::function<void(filament::Engine *, filament::View *)>;
     using DropCallback = std::function<void(std::string)>;
+    using ReadyCallback = std::function<void(void *data)>;
 
-    static FilamentAppWayland &get();
+    FilamentAppWayland();
 
     ~FilamentAppWayland();
 
-    void animate(AnimCallback animation) { mAnimation = animation; }
+    // What changed since the last rendered frame, see markDirty().
+    enum DirtyBits : uint32_t {
+        DIRTY_TRANSFORM = 0x01,
+        DIRTY_MATERIAL = 0x02,
+        DIRTY_CAMERA = 0x04,
+        DIRTY_VIEWPORT = 0x08,
+        DIRTY_IBL = 0x10,
+        DIRTY_SCENE = 0x20,
+        DIRTY_OFFSCREEN = 0x40,
+        DIRTY_ALL = 0xffffffff
+    };
+
+    // Batched rotations evaluated every frame at the frame time, cheaper than an AnimCallback
+    // for plain spinning objects. Entries must be removed before their entity is destroyed.
+    TransformAnimator &getAnimator() noexcept { return mAnimator; }
+
+    void animate(AnimCallback animation) {
+        mAnimation = animation;
+        mDirty |= DIRTY_TRANSFORM;
+    }
+
+    // Changes made outside the frame loop (transforms, material parameters, scene content, ...)
+    // must be reported here, otherwise an idle surface won't pick them up. The library only
+    // reports what it changes itself, such as the IBL it loads and the materials of meshes added
+    // with addMesh(). Other material and material instance changes, as well as IBL changes made
+    // by the app, are its own to report as DIRTY_MATERIAL and DIRTY_IBL.
+    void markDirty(uint32_t bits = DIRTY_ALL) { mDirty |= bits; }
+
+    // When enabled (the default) draw_frame() doesn't render frames whose inputs didn't change.
+    void setIdleFrameElision(bool enabled) { mIdleElision = enabled; }
+
+    [[nodiscard]] size_t getIdleFrameCount() const { return mIdleFrames; }
 
     void resize(ResizeCallback resize) { mResize = resize; }
 
+    // Records a new window size. Any number of calls between two frames are coalesced into a
+    // single swap chain reconfiguration at the start of the next draw_frame().
+    void setWindowSize(size_t width, size_t height);
+
+    [[nodiscard]] size_t getSwapChainRecreationCount() const { return mSwapChainRecreations; }
+
     void setDropHandler(DropCallback handler) { mDropHandler = handler; }
 
     void run(void *data, const Config &config, size_t width, size_t height, SetupCallback setup, CleanupCallback cleanup,
              ImGuiCallback imgui = ImGuiCallback(), PreRenderCallback preRender = PreRenderCallback(),
              PostRenderCallback postRender = PostRenderCallback());
 
-    void run_task();
+    // Same as run(), but returns immediately. The IBL files are read on a worker thread and the
+    // engine bound work is queued as a task drained by run_task(). draw_frame() does nothing
+    // until the app is ready, at which point the ready callback is invoked from run_task().
+    // Each LoadState, including the setup callback, runs as one step that the budget can't split.
+    void runAsync(void *data, const Config &config, size_t width, size_t height, SetupCallback setup,
+                  CleanupCallback cleanup, ReadyCallback ready,
+                  ImGuiCallback imgui = ImGuiCallback(), PreRenderCallback preRender = PreRenderCallback(),
+                  PostRenderCallback postRender = PostRenderCallback());
+
+    [[nodiscard]] bool isReady() const noexcept { return mLoadState == LoadState::READY; }
 
-    void draw_frame(uint32_t time);
+    // Drains the task queue for at most the given budget, returns the number of tasks left.
+    size_t run_task(std::chrono::microseconds budget);
+
+    // Background work to be spread over run_task() calls, see TaskQueue.
+    TaskQueue &getTaskQueue() noexcept { return mTasks; }
+
+    // Returns true if a new frame was submitted to the swap chain.
+    bool draw_frame(uint32_t time);
 
     void stop();
 
-    filament::Material const *getDefaultMaterial() const noexcept { return mDefaultMaterial; }
+    filament::Material const *getDefaultMaterial() const noexcept { return mSharedEngine->getDefaultMaterial(); }
+
+    filament::Material const *getTransparentMaterial() const noexcept {
+        return mSharedEngine->getTransparentMaterial();
+    }
 
-    filament::Material const *getTransparentMaterial() const noexcept { return mTransparentMaterial; }
+    // For MeshAssimp, nullptr without Config::cachePath.
+    MaterialCache *getMaterialCache() const noexcept { return mSharedEngine->getMaterialCache(); }
 
-    IBL *getIBL() const noexcept { return mIBL.get(); }
+    IBL *getIBL() const noexcept { return mIBL; }
 
     filament::Texture *getDirtTexture() const noexcept { return mDirt; }
 
@@ -105,10 +178,70 @@ public:
 
     float &getCameraFocalLength() { return mCameraFocalLength; }
 
-    void addOffscreenView(filament::View *view) { mOffscreenViews.push_back(view); }
+    // When an offscreen view is rendered. In between, its render target keeps the last result.
+    enum class OffscreenUpdate : uint8_t {
+        EVERY_FRAME,
+        EVERY_NTH_FRAME,    // every interval-th rendered frame
+        WHEN_DIRTY,         // when anything reported through DirtyBits changed since the last frame
+        ONCE                // only on the first frame and after markOffscreenViewDirty()
+    };
+
+    // draw_frame() swaps in the mesh's glTF materials as their builds finish, see
+    // MeshAssimp::updateMaterials(), and reports them as DIRTY_MATERIAL. A mesh must be removed
+    // before it is destroyed.
+    void addMesh(MeshAssimp *mesh);
+
+    void removeMesh(MeshAssimp *mesh);
+
+    // Offscreen views are rendered before the window's views, in the order they were added. All
+    // policies render the view on the first frame after it was added.
+    void addOffscreenView(filament::View *view, OffscreenUpdate update = OffscreenUpdate::EVERY_FRAME,
+                          uint32_t interval = 1);
+
+    void removeOffscreenView(filament::View *view);
+
+    void setOffscreenViewUpdate(filament::View *view, OffscreenUpdate update, uint32_t interval = 1);
+
+    // Renders the view with the next frame, whatever its policy, even if the window is idle.
+    void markOffscreenViewDirty(filament::View *view);
 
     [[nodiscard]] size_t getSkippedFrameCount() const { return mSkippedFrames; }
 
+    // Frame time as derived from the draw_frame() timestamps; drives animation and cameras.
+    FrameClock &getFrameClock() noexcept { return mFrameClock; }
+
+    // Reads every rendered frame back into a ring of bufferCount CPU buffers, see ReadbackRing.
+    // Meant for headless windows (Config::headless), whose swap chain is created readable.
+    void setReadback(uint32_t bufferCount, ReadbackRing::FrameCallback callback) {
+        mReadback = std::make_unique<ReadbackRing>(bufferCount, std::move(callback));
+    }
+
+    ReadbackRing *getReadback() const noexcept { return mReadback.get(); }
+
+    // Renders at most fps frames per second, aligned to the display refresh. 0 removes the cap.
+    void setMaxFrameRate(float fps) { mPacer.setMaxFrameRate(fps); }
+
+    // Lowers the main view's quality while frames don't fit the pacer's target frame time, see
+    // PerformanceGovernor. thermalLimit is in degrees Celsius, 0 ignores the temperature.
+    void setPerformanceGovernor(bool enabled, float thermalLimit = 0.0f);
+
+    // Limits the frames queued on the GPU, see FramePipeline. Dropped frames are reported as
+    // throttled.
+    void setFramesInFlight(FramePipeline::Mode mode, uint32_t framesInFlight) {
+        mPipeline.configure(mode, framesInFlight);
+    }
+
+    [[nodiscard]] const FramePipeline &getFramePipeline() const noexcept { return mPipeline; }
+
+    // Published by draw_frame(), FrameStats::read() may be called from any thread.
+    [[nodiscard]] const FrameStats &getStats() const noexcept { return mStats; }
+
+    // Duration histograms of each phase of the rendered frames, may be read and reset from any
+    // thread.
+    PhaseTimings &getPhaseTimings() noexcept { return mPhases; }
+
+    [[nodiscard]] const PhaseTimings &getPhaseTimings() const noexcept { return mPhases; }
+
     FilamentAppWayland(const FilamentAppWayland &rhs) = delete;
 
     FilamentAppWayland(FilamentAppWayland &&rhs) = delete;
@@ -118,7 +251,23 @@ public:
     FilamentAppWayland &operator=(FilamentAppWayland &&rhs) = delete;
 
 private:
-    FilamentAppWayland();
+    enum class LoadState : uint8_t {
+        IDLE, CREATE_ENGINE, CREATE_WINDOW, LOAD_IBL, SETUP, READY
+    };
+
+    // Runs the next loading stage, returns false if it has to wait for the worker thread.
+    bool advanceLoading(bool wait);
+
+    // Animates the transforms and updates the camera manipulators on the engine's JobSystem,
+    // then runs the app's animation callback once every job has finished.
+    void updateScene(double time, float timeStep);
+
+    void updateSceneStats();
+
+    // Renders the views whose policy or dirty flag asks for it, and only then clears the flag.
+    void renderOffscreenViews(filament::Renderer *renderer);
+
+    void publishStats();
 
     using CameraManipulator = filament::camutils::Manipulator<float>;
 
@@ -198,11 +347,16 @@ private:
 
         void resize();
 
+        // Applies a new size: recreates the swap chain, then updates viewports and cameras.
+        void setSize(size_t w, size_t h);
+
         filament::Renderer *getRenderer() { return mRenderer; }
 
         filament::SwapChain *getSwapChain() { return mSwapChain; }
 
     private:
+        filament::SwapChain *createSwapChain();
+
         void configureCamerasForWindow();
 
         void fixupMouseCoordinatesForHdpi(ssize_t &x, ssize_t &y) const;
@@ -214,14 +368,18 @@ private:
         filament::Engine::Backend mBackend;
 
         CameraManipulator *mMainCameraMan;
-        CameraManipulator *mDebugCameraMan;
+        CameraManipulator *mDebugCameraMan = nullptr;
         filament::SwapChain *mSwapChain = nullptr;
+        void *mNativeWindow = nullptr;
+        // index of the extent callback handed to the swap chain, see createSwapChain()
+        size_t mExtentSlot;
 
+        size_t mCameraCount = 0;
         utils::Entity mCameraEntities[3];
         filament::Camera *mCameras[3] = {nullptr};
         filament::Camera *mMainCamera;
-        filament::Camera *mDebugCamera;
-        filament::Camera *mOrthoCamera;
+        filament::Camera *mDebugCamera = nullptr;
+        filament::Camera *mOrthoCamera = nullptr;
 
         std::vector<std::unique_ptr<CView>> mViews;
         CView *mMainView;
@@ -243,36 +401,75 @@ private:
 
     friend class Window;
 
-    void loadIBL(const Config &config);
+    void loadIBL(const Config &config, IBL::KtxPayload *payload = nullptr);
 
     void loadDirt(const Config &config);
 
+    std::shared_ptr<SharedEngine> mSharedEngine;
     filament::Engine *mEngine = nullptr;
     filament::Scene *mScene = nullptr;
-    std::unique_ptr<IBL> mIBL;
+    IBL *mIBL = nullptr;
     filament::Texture *mDirt = nullptr;
+    void *mData = nullptr;
+
+    LoadState mLoadState = LoadState::IDLE;
+    Config mConfig;
+    size_t mInitialWidth = 0;
+    size_t mInitialHeight = 0;
+    std::future<std::unique_ptr<IBL::KtxPayload>> mIBLPayload;
+    TaskQueue mTasks;
+    SetupCallback mAppSetupCallback;
+    ReadyCallback mAppReadyCallback;
     bool mClosed = false;
-    double mTime = 0;
-    Timer_t mTimer;
+    FrameClock mFrameClock;
+    FramePacer mPacer;
+    FramePipeline mPipeline;
+    PerformanceGovernor mGovernor;
+    GpuTimer mGpuTimer;
+    double mLastRenderedTime = 0.0;
 
 
-    filament::Material const *mDefaultMaterial = nullptr;
-    filament::Material const *mTransparentMaterial = nullptr;
-    filament::Material const *mDepthMaterial = nullptr;
     filament::MaterialInstance *mDepthMI = nullptr;
     std::unique_ptr<filagui::ImGuiHelper> mImGuiHelper;
     AnimCallback mAnimation;
+    TransformAnimator mAnimator;
+    std::vector<filament::math::mat4f> mAnimatedTransforms;
+    static constexpr uint32_t kAnimatorBatchSize = 64;
     ResizeCallback mResize;
     DropCallback mDropHandler;
 //TODO    int mSidebarWidth = 0;
     size_t mSkippedFrames = 0;
+    static constexpr uint32_t kSettleFrameCount = 3;
+    uint32_t mDirty = DIRTY_ALL;
+    uint32_t mSettleFrames = 0;
+    bool mIdleElision = true;
+    size_t mIdleFrames = 0;
+    filament::math::float3 mMainLookAt[3];
+    filament::math::float3 mDebugLookAt[3];
+    size_t mSwapChainRecreations = 0;
+    FrameStats mStats;
+    PhaseTimings mPhases;
+    static constexpr uint32_t kSceneStatsInterval = 60;
+    uint32_t mSceneStatsAge = kSceneStatsInterval;
+    bool mResizePending = false;
+    size_t mPendingWidth = 0;
+    size_t mPendingHeight = 0;
     std::string mWindowTitle;
-    std::vector<filament::View *> mOffscreenViews;
+    struct OffscreenView {
+        filament::View *view;
+        OffscreenUpdate update;
+        uint32_t interval;
+        uint32_t age;       // rendered frames since the view was last rendered
+        bool dirty;         // render with the next frame that gets through beginFrame()
+    };
+    std::vector<OffscreenView> mOffscreenViews;
+    std::vector<MeshAssimp *> mMeshes;
     float mCameraFocalLength = 28.0f;
 
     std::unique_ptr<FilamentAppWayland::Window> mAppWindow;
     std::unique_ptr<Cube> mAppCameraCube;
     std::unique_ptr<Cube> mAppLightmapCube;
+    std::unique_ptr<ReadbackRing> mReadback;
 //TODO    int mAppSidebarWidth;
     float mAppCameraFocalLength;
     PreRenderCallback mAppPreRenderCallback;
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_FRAME_CLOCK_H
+#define TNT_FILAMENT_SAMPLE_FRAME_CLOCK_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Single source of frame time, driven by the presentation timestamp the host hands to
+ * draw_frame() (milliseconds, wrapping at 2^32 like a wl_callback done time).
+ *
+ * The clock never reads the system time, so feeding it the same timestamps reproduces the same
+ * animation. It also keeps an estimate of the display refresh interval, which is used to predict
+ * when the frame being built will be presented and to count frames requested faster than the
+ * display can show them.
+ *
+ * Unless the host provides the refresh rate, the estimate is the mean of the middle half of the
+ * last HISTORY_SIZE tick intervals, so it follows any display rate while the odd early tick or
+ * missed vblank doesn't move it. Ticks are only classified as early once it has MIN_SAMPLES.
+ */
+class FrameClock {
+public:
+    // Advances the clock to the host timestamp.
+    void tick(uint32_t timeMs);
+
+    // Seconds since the first tick.
+    [[nodiscard]] double now() const { return mNow; }
+
+    // Seconds between the last two ticks.
+    [[nodiscard]] float delta() const { return mDelta; }
+
+    // Time to animate to: the predicted next vblank when prediction is enabled, now() otherwise.
+    [[nodiscard]] double frameTime() const { return mPredict ? mNow + mRefreshInterval : mNow; }
+
+    [[nodiscard]] double refreshInterval() const { return mRefreshInterval; }
+
+    // Number of ticks that arrived well before the next refresh was due.
+    [[nodiscard]] size_t getEarlyFrameCount() const { return mEarlyFrames; }
+
+    [[nodiscard]] bool isEarly() const { return mEarly; }
+
+    // Whether refreshInterval() can be trusted: the host set the rate or enough ticks were seen.
+    [[nodiscard]] bool isConverged() const { return mHostRate || mSamples >= MIN_SAMPLES; }
+
+    void setPrediction(bool enabled) { mPredict = enabled; }
+
+    // The display's refresh rate as known by the host, used instead of the estimate. 0 goes back to
+    // estimating it from the ticks.
+    void setRefreshRate(float hz);
+
+    void reset();
+
+private:
+    static constexpr size_t HISTORY_SIZE = 16;
+    static constexpr size_t MIN_SAMPLES = 8;
+    // longer intervals are pauses rather than frames and aren't sampled
+    static constexpr double MAX_SAMPLED_INTERVAL = 0.25;
+
+    void addSample(double interval);
+
+    bool mStarted = false;
+    bool mHostRate = false;
+    bool mPredict = false;
+    bool mEarly = false;
+    uint32_t mLastTimeMs = 0;
+    double mNow = 0.0;
+    float mDelta = 0.0f;
+    double mRefreshInterval = 1.0 / 60.0;
+    size_t mEarlyFrames = 0;
+    std::array<float, HISTORY_SIZE> mHistory{};
+    size_t mSamples = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_FRAME_CLOCK_H
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_FRAME_PACER_H
+#define TNT_FILAMENT_SAMPLE_FRAME_PACER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+class FrameClock;
+
+/**
+ * Caps the frame rate in whole refresh intervals.
+ *
+ * With a cap of C on a display refreshing at R, a frame is rendered every round(R / C) vblanks
+ * and the draw_frame() calls in between are declined, so frames stay aligned to the display
+ * instead of drifting between vblanks. Ticks arriving early (not on a vblank) are declined as
+ * well while a cap is active. Until the clock's refresh estimate has converged, frames are only
+ * paced by the cap's frame time, and a frame is never declined once that much time has passed.
+ */
+class FramePacer {
+public:
+    // 0 removes the cap.
+    void setMaxFrameRate(float fps);
+
+    [[nodiscard]] float getMaxFrameRate() const { return mMaxFrameRate; }
+
+    // Called once per tick of the clock. Returns false if this tick should not produce a frame.
+    bool shouldRender(const FrameClock &clock);
+
+    // Refresh intervals per rendered frame.
+    [[nodiscard]] uint32_t getInterval() const { return mInterval; }
+
+    // Display rate the interval was derived from, rounded to 0.5 Hz.
+    [[nodiscard]] float getRefreshRate() const { return mRefreshRate; }
+
+    // Seconds between two rendered frames.
+    [[nodiscard]] double getTargetFrameTime() const { return mInterval / double(mRefreshRate); }
+
+    // True once after the interval or refresh rate changed.
+    bool consumeChanged();
+
+    [[nodiscard]] size_t getPacedFrameCount() const { return mPacedFrames; }
+
+private:
+    float mMaxFrameRate = 0.0f;
+    float mRefreshRate = 60.0f;
+    uint32_t mInterval = 1;
+    double mSinceLastFrame = HUGE_VAL;
+    bool mChanged = true;
+    size_t mPacedFrames = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_FRAME_PACER_H
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_FRAME_PIPELINE_H
+#define TNT_FILAMENT_SAMPLE_FRAME_PIPELINE_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace filament {
+    class Engine;
+    class Fence;
+}
+
+/**
+ * Bounds the number of frames submitted but not yet completed by the GPU.
+ *
+ * A fence is placed after every submitted frame. Once the limit is reached, LOW_LATENCY waits for
+ * the oldest frame to complete before the next one samples its inputs, so what's shown is never
+ * more than framesInFlight frames old. HIGH_THROUGHPUT lets the next frame sample its inputs and
+ * update the scene right away and only waits before submitting it, so that CPU work overlaps the
+ * GPU finishing the oldest frame.
+ *
+ * Either way, a frame is dropped when no frame in flight completes within the caller's maxWait.
+ * Single threaded builds can't wait on a fence with a timeout, they execute the engine and poll
+ * the oldest fence until then instead.
+ *
+ * Disabled (framesInFlight == 0) by default, leaving pacing entirely to filament.
+ */
+class FramePipeline {
+public:
+    enum class Mode : uint8_t {
+        LOW_LATENCY, HIGH_THROUGHPUT
+    };
+
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
+    explicit FramePipeline(filament::Engine *engine = nullptr) : mEngine(engine) {}
+
+    ~FramePipeline() { reset(); }
+
+    FramePipeline(const FramePipeline &) = delete;
+
+    FramePipeline &operator=(const FramePipeline &) = delete;
+
+    void setEngine(filament::Engine *engine);
+
+    // framesInFlight is clamped to [1, MAX_FRAMES_IN_FLIGHT], 0 disables the pipeline.
+    void configure(Mode mode, uint32_t framesInFlight);
+
+    [[nodiscard]] Mode getMode() const { return mMode; }
+
+    [[nodiscard]] uint32_t getFramesInFlight() const { return mLimit; }
+
+    // Before a new frame samples its inputs. LOW_LATENCY waits at most maxWait for the oldest
+    // frame, returns false if the frame should be dropped.
+    bool acquire(std::chrono::microseconds maxWait);
+
+    // After the frame's scene update, before Renderer::beginFrame(). HIGH_THROUGHPUT waits at most
+    // maxWait for the oldest frame, returns false if the frame should be dropped.
+    bool reserve(std::chrono::microseconds maxWait);
+
+    // After Renderer::endFrame().
+    void submitted();
+
+    // Number of frames acquire() or reserve() dropped.
+    [[nodiscard]] size_t getThrottledFrameCount() const { return mThrottled; }
+
+    // Forgets all frames in flight, must be called before the engine goes away.
+    void reset();
+
+private:
+    void retireCompleted();
+
+    void retireOldest();
+
+    // Waits at most maxWait for a free slot, counting the frame as throttled if none frees up.
+    bool waitForSlot(std::chrono::microseconds maxWait);
+
+    filament::Engine *mEngine = nullptr;
+    Mode mMode = Mode::HIGH_THROUGHPUT;
+    uint32_t mLimit = 0;
+    std::array<filament::Fence *, MAX_FRAMES_IN_FLIGHT + 1> mFences{};
+    uint32_t mHead = 0;
+    uint32_t mCount = 0;
+    size_t mThrottled = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_FRAME_PIPELINE_H
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_FRAME_STATS_H
+#define TNT_FILAMENT_SAMPLE_FRAME_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Per frame statistics written by the render thread and read from any other thread.
+ *
+ * The render thread fills in the working copy returned by edit() and makes it visible with
+ * publish(). Readers get a consistent copy through read() without taking a lock; the snapshot is
+ * guarded by a sequence counter and read() simply retries if it raced with a publish.
+ */
+class FrameStats {
+public:
+    struct Snapshot {
+        uint64_t framesRendered = 0;
+        uint64_t framesSkipped = 0;     // beginFrame() returned false
+        uint64_t framesIdle = 0;        // nothing changed, frame not rendered
+        uint64_t framesEarly = 0;       // requested faster than the display refresh
+        uint64_t swapChainRecreations = 0;
+
+        float lastFrameMs = 0.0f;       // CPU time of the last rendered frame
+        float p50FrameMs = 0.0f;        // over the last HISTORY_SIZE rendered frames
+        float p95FrameMs = 0.0f;
+        float p99FrameMs = 0.0f;
+
+        uint32_t entityCount = 0;
+        uint32_t renderableCount = 0;
+        uint32_t drawCount = 0;         // primitives rendered by all views, before culling
+
+        int64_t meshCpuBytes = 0;
+        int64_t meshGpuBytes = 0;
+        int64_t textureCpuBytes = 0;
+        int64_t textureGpuBytes = 0;
+        int64_t materialCpuBytes = 0;
+        int64_t materialGpuBytes = 0;
+
+        uint64_t framesPaced = 0;       // declined by the frame rate cap
+        float targetFrameMs = 0.0f;     // time between frames the pacer aims for
+
+        uint32_t qualityLevel = 0;      // PerformanceGovernor::Level
+        float temperature = 0.0f;       // hottest thermal zone, Celsius
+
+        float updateMs = 0.0f;          // wall time of the parallel update phase, last frame
+        float animationJobMs = 0.0f;    // CPU time summed over the animation jobs, last frame
+        float manipulatorJobMs = 0.0f;  // CPU time summed over the manipulator jobs, last frame
+        uint32_t updateJobCount = 0;    // jobs run by the update phase, last frame
+
+        uint64_t framesThrottled = 0;   // dropped by FramePipeline, too many frames in flight
+    };
+
+    static constexpr size_t HISTORY_SIZE = 256;
+
+    // Render thread only. Adds a rendered frame's CPU time to the rolling window.
+    void addFrameTime(float ms);
+
+    // Render thread only. Working copy, not visible to readers until publish().
+    Snapshot &edit() { return mWorking; }
+
+    // Render thread only. Updates the percentiles and publishes the working copy.
+    void publish();
+
+    // Any thread.
+    [[nodiscard]] Snapshot read() const;
+
+private:
+    static constexpr size_t WORD_COUNT = (sizeof(Snapshot) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    Snapshot mWorking;
+    std::array<float, HISTORY_SIZE> mHistory{};
+    size_t mHistoryCount = 0;
+    size_t mHistoryHead = 0;
+    bool mHistoryChanged = false;
+
+    std::atomic<uint32_t> mSequence{0};
+    std::atomic<uint64_t> mWords[WORD_COUNT] = {};
+};
+
+#endif // TNT_FILAMENT_SAMPLE_FRAME_STATS_H
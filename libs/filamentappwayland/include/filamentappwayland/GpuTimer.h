@@ -0,0 +1,93 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_GPU_TIMER_H
+#define TNT_FILAMENT_SAMPLE_GPU_TIMER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace filament {
+    class Engine;
+    class Fence;
+}
+
+/**
+ * Estimates how long the backend was busy with each frame, without the time spent waiting for
+ * vsync that bounds the frame interval.
+ *
+ * A fence is placed after every submitted frame and waited on by a thread of its own, which
+ * notes when it signals. A frame is busy from its submission, or the completion of the previous
+ * frame if that came later, until its own completion.
+ *
+ * Fences can't be waited on from another thread in single threaded builds, there the timer
+ * stays at 0.
+ */
+class GpuTimer {
+public:
+    GpuTimer() = default;
+
+    ~GpuTimer() { setEngine(nullptr); }
+
+    GpuTimer(const GpuTimer &) = delete;
+
+    GpuTimer &operator=(const GpuTimer &) = delete;
+
+    // Stops the waiting thread and drops all fences when the engine changes or goes away.
+    void setEngine(filament::Engine *engine);
+
+    // After Renderer::endFrame(), engine thread.
+    void submitted();
+
+    // Busy time of the last completed frame, 0 until one completed.
+    [[nodiscard]] float getFrameMs() const { return mFrameMs.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t MAX_PENDING = 4;
+
+    struct Frame {
+        filament::Fence *fence;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    void run();
+
+    void stop();
+
+    // Engine thread, destroys the fences the waiting thread is done with.
+    void retire();
+
+    filament::Engine *mEngine = nullptr;
+    std::thread mThread;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::array<Frame, MAX_PENDING> mFrames{};
+    uint64_t mSubmitted = 0;    // sequence numbers, mRetired <= mCompleted <= mSubmitted
+    uint64_t mCompleted = 0;
+    uint64_t mRetired = 0;
+    bool mStop = false;
+
+    std::atomic<float> mFrameMs{0.0f};
+};
+
+#endif // TNT_FILAMENT_SAMPLE_GPU_TIMER_H
@@ -21,6 +21,7 @@
 
 #include <math/vec3.h>
 
+#include <memory>
 #include <string>
 
 namespace filament {
@@ -45,8 +46,23 @@ namespace utils {
     class Path;
 }
 
+namespace image {
+    class Ktx1Bundle;
+}
+
 class IBL {
 public:
+    // KTX files of an IBL, read and parsed without touching the engine.
+    struct KtxPayload {
+        image::Ktx1Bundle *ibl = nullptr;
+        image::Ktx1Bundle *skybox = nullptr;
+
+        ~KtxPayload();
+    };
+
+    // Safe to call from any thread. Returns nullptr if the directory has no KTX files.
+    static std::unique_ptr<KtxPayload> prefetchFromDirectory(const utils::Path &path);
+
     explicit IBL(filament::Engine &engine);
 
     ~IBL();
@@ -57,6 +73,9 @@ public:
 
     bool loadFromKtx(const std::string &prefix);
 
+    // Uploads a prefetched payload, the payload's bundles are consumed.
+    bool loadFromPayload(KtxPayload &payload);
+
     filament::IndirectLight *getIndirectLight() const noexcept {
         return mIndirectLight;
     }
@@ -68,6 +87,11 @@ public:
     filament::math::float3 const *getSphericalHarmonics() const { return mBands; }
 
 private:
+    static std::unique_ptr<KtxPayload> readKtx(const std::string &prefix);
+
+    // Reports the loaded textures to ResourceStats.
+    void trackTextures();
+
     bool loadCubemapLevel(filament::Texture **texture, const utils::Path &path,
                           size_t level = 0, std::string const &levelPrefix = "") const;
 
@@ -86,6 +110,7 @@ private:
     filament::IndirectLight *mIndirectLight = nullptr;
     filament::Texture *mSkyboxTexture = nullptr;
     filament::Skybox *mSkybox = nullptr;
+    int64_t mTextureBytes = 0;
 };
 
 #endif // TNT_FILAMENT_SAMPLE_IBL_H
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_MATERIAL_CACHE_H
+#define TNT_FILAMENT_SAMPLE_MATERIAL_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * On-disk cache of compiled material packages, so that materials generated at runtime are only
+ * compiled by filamat once per device.
+ *
+ * Packages are keyed by a hash of whatever was compiled; the tag given to the constructor is
+ * added to every file name and should identify everything else the package depends on (backend,
+ * feature level, material format version). Entries with a different tag are never loaded and are
+ * the first to be evicted.
+ *
+ * The cache is kept under maxBytes by evicting the least recently used entries. Use is tracked
+ * through the files' modification times, so the order survives restarts. All methods are thread
+ * safe, files are written to a temporary name first so a crash never leaves a partial entry.
+ */
+class MaterialCache {
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = 32u * 1024u * 1024u;
+
+    MaterialCache(std::string directory, std::string tag, size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    // Reads the package stored for key into out. Returns false if there is none or it is corrupt.
+    bool load(uint64_t key, std::vector<uint8_t> &out);
+
+    void store(uint64_t key, const void *data, size_t size);
+
+    [[nodiscard]] size_t getSize() const;
+
+    MaterialCache(const MaterialCache &rhs) = delete;
+
+    MaterialCache &operator=(const MaterialCache &rhs) = delete;
+
+private:
+    struct Entry {
+        size_t size;
+        int64_t lastUse;
+    };
+
+    std::string getFileName(uint64_t key) const;
+
+    // Requires mLock.
+    void remove(const std::string &name);
+
+    // Requires mLock. Evicts until another size bytes fit.
+    void evict(size_t size);
+
+    const std::string mDirectory;
+    const std::string mTag;
+    const size_t mMaxBytes;
+
+    mutable std::mutex mLock;
+    std::unordered_map<std::string, Entry> mEntries;
+    size_t mTotalBytes = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_MATERIAL_CACHE_H
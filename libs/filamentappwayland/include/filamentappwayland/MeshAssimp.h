@@ -31,6 +31,8 @@ namespace filament {
     class Renderable;
 }
 
+#include <functional>
+#include <future>
 #include <unordered_map>
 #include <map>
 #include <vector>
@@ -43,7 +45,6 @@ namespace filament {
 #include <utils/EntityManager.h>
 #include <utils/Path.h>
 
-#include <filamat/MaterialBuilder.h>
 #include <filament/Color.h>
 #include <filament/Box.h>
 #include <filament/Texture.h>
@@ -51,6 +52,8 @@ namespace filament {
 #include <filament/TransformManager.h>
 #include <assimp/scene.h>
 
+#include "MaterialCache.h"
+
 class MeshAssimp {
 public:
     using mat4f = filament::math::mat4f;
@@ -59,14 +62,26 @@ public:
     using half2 = filament::math::half2;
     using ushort2 = filament::math::ushort2;
 
-    explicit MeshAssimp(filament::Engine &engine);
+    // glTF materials come from the precompiled variants when the build has them, others are
+    // compiled at runtime; with a cache those packages are kept across runs.
+    explicit MeshAssimp(filament::Engine &engine, MaterialCache *materialCache = nullptr);
 
     ~MeshAssimp();
 
+    // glTF materials that have to be compiled are built on worker threads, one per distinct
+    // configuration. Until updateMaterials() swaps them in, their parts render with a default
+    // material instance, which is what materials holds for them in the meantime; the map must
+    // outlive the pending builds.
     void addFromFile(const utils::Path &path,
                      std::map<std::string, filament::MaterialInstance *> &materials,
                      bool overrideMaterial = false);
 
+    // Engine thread, between frames. Replaces the default instances of glTF materials whose build
+    // finished with the real ones, destroying the defaults. Returns true while builds are pending.
+    // swapped is set when any instance was replaced, which has to be reported as
+    // FilamentAppWayland::DIRTY_MATERIAL. FilamentAppWayland::addMesh() does both every frame.
+    bool updateMaterials(bool *swapped = nullptr);
+
     const std::vector<utils::Entity> getRenderables() const noexcept {
         return mRenderables;
     }
@@ -129,7 +144,20 @@ private:
 
     filament::Texture *createOneByOneTexture(uint32_t textureData);
 
+    // MaterialInstance::setParameter() calls, kept until the instance exists.
+    using MaterialSetup = std::vector<std::function<void(filament::MaterialInstance *)>>;
+
+    // A glTF material rendering with placeholder until the material for configHash is built.
+    struct PendingMaterial {
+        uint64_t configHash;
+        std::string name;
+        std::map<std::string, filament::MaterialInstance *> *materials;
+        filament::MaterialInstance *placeholder;
+        MaterialSetup setup;
+    };
+
     filament::Engine &mEngine;
+    MaterialCache *const mMaterialCache;
     filament::VertexBuffer *mVertexBuffer = nullptr;
     filament::IndexBuffer *mIndexBuffer = nullptr;
 
@@ -137,6 +165,8 @@ private:
     filament::Material *mDefaultTransparentColorMaterial = nullptr;
 
     mutable std::unordered_map<uint64_t, filament::Material *> mGltfMaterialCache;
+    mutable std::unordered_map<uint64_t, std::future<std::vector<uint8_t>>> mMaterialBuilds;
+    mutable std::vector<PendingMaterial> mPendingMaterials;
     filament::Texture *mDefaultMap = nullptr;
     filament::Texture *mDefaultNormalMap = nullptr;
     float mDefaultMetallic = 0.0f;
@@ -147,6 +177,10 @@ private:
 
     std::vector<filament::Texture *> mTextures;
 
+    // bytes reported to ResourceStats, given back on destruction
+    mutable int64_t mMaterialBytes = 0;
+    int64_t mMeshBytes = 0;
+
 
 };
 
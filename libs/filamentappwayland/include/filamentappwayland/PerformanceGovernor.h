@@ -0,0 +1,118 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_PERFORMANCE_GOVERNOR_H
+#define TNT_FILAMENT_SAMPLE_PERFORMANCE_GOVERNOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <filament/LightManager.h>
+#include <filament/Options.h>
+#include <filament/View.h>
+
+#include <utils/Entity.h>
+
+namespace filament {
+    class Engine;
+    class Scene;
+}
+
+/**
+ * Trades image quality for frame time on one view.
+ *
+ * Fed with the CPU and GPU time of every rendered frame, the governor steps down one quality level
+ * when frames stay over budget and back up when they stay well under it. The interval between
+ * frames only tells when vblanks are missed: on a paced surface it never drops below the budget,
+ * so it says nothing about headroom. The gap between the two thresholds and the longer wait
+ * before restoring keep it from oscillating.
+ * Optionally the hottest thermal zone in /sys/class/thermal is treated as being over budget once
+ * it passes a limit, so quality drops before the SoC throttles.
+ *
+ * Levels are cumulative, each one also applies all the ones before it. The view and light
+ * settings found when first leaving FULL are restored when coming back. Shadow casters added to
+ * the scene later are picked up when the caller reports a scene change.
+ */
+class PerformanceGovernor {
+public:
+    enum Level : uint8_t {
+        FULL,
+        DYNAMIC_RESOLUTION,     // let filament scale the render target down to 60%
+        NO_MSAA,                // MSAA off, FXAA instead
+        NO_SSAO,
+        NO_BLOOM,
+        LOW_SHADOWS,            // shadow maps at 512
+        NO_CONTACT_SHADOWS,     // screen space contact shadows off
+        LEVEL_COUNT
+    };
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+
+    [[nodiscard]] bool isEnabled() const { return mEnabled; }
+
+    // Degrees Celsius, 0 disables the thermal input.
+    void setThermalLimit(float celsius) { mThermalLimit = celsius; }
+
+    // Once per rendered frame. gpuMs is 0 when unknown. frameInterval is the time since the
+    // previous rendered frame, budget the time per frame to fit in, both in seconds.
+    // sceneChanged re-collects the shadow casters. Returns true if the level changed.
+    bool update(filament::Engine &engine, filament::View *view, filament::Scene *scene,
+                float cpuMs, float gpuMs, double frameInterval, double budget, bool sceneChanged);
+
+    // Back to FULL, e.g. before the view goes away or when disabling.
+    void restore(filament::Engine &engine, filament::View *view);
+
+    [[nodiscard]] uint8_t getLevel() const { return mLevel; }
+
+    // Last temperature read, 0 if the thermal input is disabled or unavailable.
+    [[nodiscard]] float getTemperature() const { return mTemperature; }
+
+private:
+    struct Saved {
+        filament::AntiAliasing antiAliasing;
+        filament::MultiSampleAntiAliasingOptions msaa;
+        filament::AmbientOcclusionOptions ssao;
+        filament::BloomOptions bloom;
+        filament::DynamicResolutionOptions dynamicResolution;
+        std::vector<std::pair<utils::Entity, filament::LightManager::ShadowOptions>> shadows;
+    };
+
+    void save(filament::Engine &engine, filament::View *view, filament::Scene *scene);
+
+    // Adds the casters not seen yet with their current options and forgets destroyed ones.
+    void collectShadowCasters(filament::Engine &engine, filament::Scene *scene);
+
+    void apply(filament::Engine &engine, filament::View *view, uint8_t level);
+
+    float readTemperature();
+
+    bool mEnabled = false;
+    float mThermalLimit = 0.0f;
+    float mTemperature = 0.0f;
+    uint32_t mThermalAge = 0;
+
+    uint8_t mLevel = FULL;
+    bool mSaved = false;
+    Saved mOriginal{};
+
+    double mLoad = 0.0;         // smoothed CPU + GPU time over budget
+    uint32_t mOverBudget = 0;
+    uint32_t mUnderBudget = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_PERFORMANCE_GOVERNOR_H
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_PHASE_TIMINGS_H
+#define TNT_FILAMENT_SAMPLE_PHASE_TIMINGS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "TraceRecorder.h"
+
+/**
+ * Duration histograms for each phase of a frame.
+ *
+ * Samples are recorded by the render thread, typically through a Scope around the phase, which
+ * also emits a trace event while the TraceRecorder is enabled. Every histogram is a fixed set of
+ * atomic counters, so summary() and reset() may be called from any thread without a lock. A reset
+ * racing with a frame may drop that frame's samples.
+ *
+ * Buckets are spaced logarithmically, four per power of two microseconds, so percentiles are
+ * accurate to about 20% from a microsecond up to several seconds.
+ */
+class PhaseTimings {
+public:
+    enum class Phase : uint8_t {
+        FRAME,          // whole draw_frame() call that rendered
+        EXECUTE,        // Engine::execute(), single threaded builds only
+        UPDATE,         // wall time of the parallel scene update
+        ANIMATION,      // animation jobs, CPU time summed over all jobs, and the app's callback
+        MANIPULATORS,   // camera manipulator jobs, CPU time summed over all jobs
+        FRUSTUM,        // frustum visualization cubes
+        OFFSCREEN_VIEWS,
+        VIEW_0,         // Renderer::render() of each window view, in order
+        VIEW_1,
+        VIEW_2,
+        VIEW_3,
+        END_FRAME,
+        COUNT
+    };
+
+    static constexpr size_t PHASE_COUNT = size_t(Phase::COUNT);
+    static constexpr size_t MAX_VIEWS = size_t(Phase::END_FRAME) - size_t(Phase::VIEW_0);
+    static constexpr size_t BUCKET_COUNT = 96;
+
+    struct Summary {
+        uint64_t count = 0;
+        float minMs = 0.0f;
+        float maxMs = 0.0f;
+        float meanMs = 0.0f;
+        float p50Ms = 0.0f;
+        float p95Ms = 0.0f;
+        float p99Ms = 0.0f;
+    };
+
+    // Records the time from construction to destruction.
+    class Scope {
+    public:
+        Scope(PhaseTimings &timings, Phase phase)
+                : mTrace(getName(phase), "frame"), mTimings(timings), mPhase(phase),
+                  mStart(std::chrono::steady_clock::now()) {}
+
+        ~Scope() {
+            mTimings.record(mPhase, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - mStart));
+        }
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        TraceRecorder::Scope mTrace;
+        PhaseTimings &mTimings;
+        Phase mPhase;
+        std::chrono::steady_clock::time_point mStart;
+    };
+
+    [[nodiscard]] Scope scope(Phase phase) { return { *this, phase }; }
+
+    static Phase view(size_t index) { return Phase(size_t(Phase::VIEW_0) + index); }
+
+    static const char *getName(Phase phase);
+
+    // Render thread only.
+    void record(Phase phase, std::chrono::nanoseconds duration);
+
+    // Any thread.
+    [[nodiscard]] Summary summary(Phase phase) const;
+
+    // Any thread.
+    void reset();
+
+private:
+    struct Histogram {
+        std::array<std::atomic<uint32_t>, BUCKET_COUNT> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> minNs{UINT64_MAX};
+        std::atomic<uint64_t> maxNs{0};
+    };
+
+    static size_t bucketIndex(uint64_t us);
+
+    static uint64_t bucketStart(size_t index);
+
+    std::array<Histogram, PHASE_COUNT> mHistograms;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_PHASE_TIMINGS_H
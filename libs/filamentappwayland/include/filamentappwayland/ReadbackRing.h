@@ -0,0 +1,100 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_READBACK_RING_H
+#define TNT_FILAMENT_SAMPLE_READBACK_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace filament {
+    class Renderer;
+}
+
+/**
+ * Reads rendered frames back into a ring of CPU buffers without stalling the render loop.
+ *
+ * Each frame is read into a free buffer with an asynchronous Renderer::readPixels(). The GPU
+ * copy of frame N completes while frame N+1 is being built; the frame callback is then invoked
+ * from the render thread (inside a later beginFrame) with a pointer into the ring, no copy is
+ * made. The buffer belongs to the receiver until it's handed back with release(). Frames are
+ * dropped, not waited for, when every buffer is either being read or held.
+ *
+ * Pixels are RGBA8, rows are tightly packed and ordered bottom to top.
+ */
+class ReadbackRing {
+public:
+    using FrameCallback = std::function<void(uint32_t index, const void *pixels,
+                                             uint32_t width, uint32_t height, uint32_t stride)>;
+
+    static constexpr uint32_t MAX_BUFFERS = 8;
+
+    ReadbackRing(uint32_t bufferCount, FrameCallback callback);
+
+    ~ReadbackRing();
+
+    ReadbackRing(const ReadbackRing &) = delete;
+
+    ReadbackRing &operator=(const ReadbackRing &) = delete;
+
+    // Render thread, after the views are rendered and before Renderer::endFrame().
+    // Returns false if the frame was dropped.
+    bool readFrame(filament::Renderer *renderer, uint32_t width, uint32_t height);
+
+    // Any thread. Hands a buffer received by the frame callback back to the ring.
+    void release(uint32_t index);
+
+    [[nodiscard]] uint32_t getBufferCount() const { return mShared->count; }
+
+    [[nodiscard]] size_t getDroppedFrameCount() const { return mDroppedFrames; }
+
+private:
+    enum State : uint8_t {
+        FREE, READING, HELD
+    };
+
+    struct Slot {
+        std::atomic<uint8_t> state{FREE};
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // Outlives the ring while reads are in flight, their completion may come after destruction.
+    struct Shared {
+        FrameCallback callback;
+        std::atomic<bool> detached{false};
+        uint32_t count = 0;
+        Slot slots[MAX_BUFFERS];
+    };
+
+    struct Pending {
+        std::shared_ptr<Shared> shared;
+        uint32_t index;
+    };
+
+    static void onReadComplete(void *buffer, size_t size, void *user);
+
+    std::shared_ptr<Shared> mShared;
+    uint32_t mNext = 0;
+    size_t mDroppedFrames = 0;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_READBACK_RING_H
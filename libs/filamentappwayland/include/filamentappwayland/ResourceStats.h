@@ -0,0 +1,56 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_RESOURCE_STATS_H
+#define TNT_FILAMENT_SAMPLE_RESOURCE_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace filament {
+    class Texture;
+}
+
+/**
+ * Process wide byte counters for the resources created by this library. Filament doesn't report
+ * memory usage, so the code creating meshes, textures and materials accounts for them here.
+ * GPU sizes are estimates based on format, dimensions and mip chain.
+ */
+class ResourceStats {
+public:
+    enum class Kind : uint8_t {
+        MESH, TEXTURE, MATERIAL
+    };
+
+    // Deltas may be negative, e.g. when a resource is destroyed.
+    static void track(Kind kind, int64_t cpuBytes, int64_t gpuBytes);
+
+    static int64_t getCpuBytes(Kind kind);
+
+    static int64_t getGpuBytes(Kind kind);
+
+    // Estimated GPU footprint of a texture, including all its levels.
+    static int64_t estimateTextureBytes(const filament::Texture *texture);
+
+private:
+    static constexpr size_t KIND_COUNT = 3;
+
+    static std::atomic<int64_t> sCpuBytes[KIND_COUNT];
+    static std::atomic<int64_t> sGpuBytes[KIND_COUNT];
+};
+
+#endif // TNT_FILAMENT_SAMPLE_RESOURCE_STATS_H
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_SHARED_ENGINE_H
+#define TNT_FILAMENT_SAMPLE_SHARED_ENGINE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <filament/Engine.h>
+
+#include "Config.h"
+#include "IBL.h"
+#include "MaterialCache.h"
+
+namespace filament {
+    class Material;
+
+    class Texture;
+} // namespace filament
+
+/**
+ * Process wide, reference counted owner of the filament::Engine.
+ *
+ * Every FilamentAppWayland instance holds a reference; the Engine, its JobSystem and the
+ * material / texture caches below are created by the first reference and torn down when the
+ * last one is released. Filament engines are not thread safe, so all contexts sharing an
+ * engine must be driven from the same thread.
+ */
+class SharedEngine {
+public:
+    static std::shared_ptr<SharedEngine> acquire(const Config &config);
+
+    ~SharedEngine();
+
+    filament::Engine *getEngine() const noexcept { return mEngine; }
+
+    filament::Engine::Backend getBackend() const noexcept { return mBackend; }
+
+    // The debug materials are only built for configs with Config::hasDebugViews(), they are
+    // nullptr otherwise.
+    filament::Material const *getDefaultMaterial() const noexcept { return mDefaultMaterial; }
+
+    filament::Material const *getTransparentMaterial() const noexcept { return mTransparentMaterial; }
+
+    filament::Material const *getDepthMaterial() const noexcept { return mDepthMaterial; }
+
+    // Returns the IBL for the given path, loading it on first use. nullptr if it failed to load.
+    // A payload prefetched with IBL::prefetchFromDirectory() is used instead of reading the files.
+    IBL *getIBL(const std::string &path, IBL::KtxPayload *payload = nullptr);
+
+    // Returns the dirt texture for the given file, loading it on first use. nullptr on failure.
+    filament::Texture *getDirt(const std::string &path);
+
+    // Compiled material packages of the engine's backend and feature level, kept in
+    // Config::cachePath. nullptr without a cache path.
+    MaterialCache *getMaterialCache() const noexcept { return mMaterialCache.get(); }
+
+    SharedEngine(const SharedEngine &rhs) = delete;
+
+    SharedEngine(SharedEngine &&rhs) = delete;
+
+    SharedEngine &operator=(const SharedEngine &rhs) = delete;
+
+    SharedEngine &operator=(SharedEngine &&rhs) = delete;
+
+private:
+    explicit SharedEngine(const Config &config);
+
+    void createDebugMaterials();
+
+    static std::mutex sMutex;
+    static std::weak_ptr<SharedEngine> sInstance;
+
+    filament::Engine *mEngine = nullptr;
+    filament::Engine::Backend mBackend;
+
+    filament::Material const *mDefaultMaterial = nullptr;
+    filament::Material const *mTransparentMaterial = nullptr;
+    filament::Material const *mDepthMaterial = nullptr;
+
+    std::unordered_map<std::string, std::unique_ptr<IBL>> mIBLs;
+    std::unordered_map<std::string, filament::Texture *> mDirtTextures;
+    std::unique_ptr<MaterialCache> mMaterialCache;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_SHARED_ENGINE_H
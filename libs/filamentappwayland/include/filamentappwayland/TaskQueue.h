@@ -0,0 +1,65 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_TASK_QUEUE_H
+#define TNT_FILAMENT_SAMPLE_TASK_QUEUE_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+/**
+ * Prioritized queue of resumable work items, drained from the host thread within a time budget.
+ *
+ * A task is called repeatedly until it reports DONE, so long running work (mesh conversion,
+ * texture uploads, material builds, cache writes) is expected to be split into steps that each
+ * fit comfortably in a frame. Tasks may be posted from any thread, they always run on the thread
+ * calling run().
+ */
+class TaskQueue {
+public:
+    enum class Priority : uint8_t {
+        HIGH, NORMAL, LOW
+    };
+
+    enum class Status : uint8_t {
+        DONE,       // finished, drop it
+        PENDING,    // more steps to do, call again as soon as the budget allows
+        BLOCKED     // waiting on something else (e.g. a worker thread), retry on the next run()
+    };
+
+    using Task = std::function<Status()>;
+
+    void post(Task task, Priority priority = Priority::NORMAL);
+
+    // Runs task steps in priority order until the queue is empty or the budget is used up.
+    // At least one step runs per call. Returns the number of tasks still queued.
+    size_t run(std::chrono::microseconds budget);
+
+    [[nodiscard]] size_t size() const;
+
+    void clear();
+
+private:
+    static constexpr size_t PRIORITY_COUNT = 3;
+
+    mutable std::mutex mLock;
+    std::deque<Task> mQueues[PRIORITY_COUNT];
+};
+
+#endif // TNT_FILAMENT_SAMPLE_TASK_QUEUE_H
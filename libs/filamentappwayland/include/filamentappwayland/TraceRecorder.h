@@ -0,0 +1,88 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_TRACE_RECORDER_H
+#define TNT_FILAMENT_SAMPLE_TRACE_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Process wide recorder of timed events, written out in the Chrome trace event format that
+ * chrome://tracing and ui.perfetto.dev load directly.
+ *
+ * Events are kept in a ring buffer allocated by enable(); once it is full the oldest events are
+ * overwritten. Recording is lock free and may happen on any thread. While disabled a Scope costs
+ * a single relaxed atomic load.
+ *
+ * Names and categories are not copied, they must be string literals or otherwise outlive the
+ * recorder.
+ */
+class TraceRecorder {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+    // Records the time from construction to destruction on the calling thread.
+    class Scope {
+    public:
+        Scope(const char *name, const char *category)
+                : mName(TraceRecorder::isEnabled() ? name : nullptr), mCategory(category),
+                  mStart(mName ? TraceRecorder::now() : 0) {}
+
+        ~Scope() {
+            if (mName) {
+                TraceRecorder::record(mName, mCategory, mStart, TraceRecorder::now());
+            }
+        }
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *mName;
+        const char *mCategory;
+        uint64_t mStart;
+    };
+
+    // Starts recording into a ring of capacity events, dropping anything recorded before.
+    static void enable(size_t capacity = DEFAULT_CAPACITY);
+
+    // Stops recording, the recorded events are kept until the next enable().
+    static void disable();
+
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds on the steady clock.
+    static uint64_t now();
+
+    static void record(const char *name, const char *category, uint64_t startNs, uint64_t endNs);
+
+    // Writes the events currently in the ring as Chrome trace JSON. Recording may continue while
+    // this runs, events overwritten in the meantime are left out.
+    static bool write(const std::string &path);
+
+private:
+    struct Event;
+    struct Ring;
+
+    static std::atomic<bool> sEnabled;
+    static std::atomic<Ring *> sRing;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_TRACE_RECORDER_H
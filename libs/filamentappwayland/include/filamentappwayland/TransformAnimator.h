@@ -0,0 +1,76 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TNT_FILAMENT_SAMPLE_TRANSFORM_ANIMATOR_H
+#define TNT_FILAMENT_SAMPLE_TRANSFORM_ANIMATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include <math/mat4.h>
+#include <math/vec3.h>
+
+#include <utils/Entity.h>
+
+namespace filament {
+    class TransformManager;
+}
+
+/**
+ * Spins entities around an axis, all of them in one batch.
+ *
+ * Each animated entity's local transform is base * rotation(phase + speed * time, axis). The
+ * parameters are kept in parallel arrays, update() walks them once and writes every transform
+ * inside a single local transform transaction, so world transforms are only recomputed once
+ * at commit time. Adding entities is the only operation that may allocate.
+ */
+class TransformAnimator {
+public:
+    using mat4f = filament::math::mat4f;
+    using float3 = filament::math::float3;
+
+    // speed in radians per second.
+    void add(utils::Entity entity, const mat4f &base, float3 axis, float speed, float phase = 0.0f);
+
+    void remove(utils::Entity entity);
+
+    void clear();
+
+    void reserve(size_t count);
+
+    [[nodiscard]] bool empty() const { return mEntities.empty(); }
+
+    [[nodiscard]] size_t size() const { return mEntities.size(); }
+
+    // Sets all transforms for the given time in seconds.
+    void update(filament::TransformManager &tcm, double time) const;
+
+    // The two halves of update(). evaluate() only reads the animator and writes out[0, count) for
+    // entries [start, start + count), so disjoint ranges can be evaluated concurrently. apply()
+    // must run on the engine's thread with size() transforms.
+    void evaluate(double time, size_t start, size_t count, mat4f *out) const;
+
+    void apply(filament::TransformManager &tcm, const mat4f *transforms) const;
+
+private:
+    std::vector<utils::Entity> mEntities;
+    std::vector<mat4f> mBases;
+    std::vector<float3> mAxes;
+    std::vector<float> mSpeeds;
+    std::vector<float> mPhases;
+};
+
+#endif // TNT_FILAMENT_SAMPLE_TRANSFORM_ANIMATOR_H
@@ -19,12 +19,16 @@
 #include <filamentappwayland/FilamentAppWayland.h>
 
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <utility>
 
 #include <imgui.h>
 
 #include <utils/EntityManager.h>
+#include <utils/JobSystem.h>
 #include <utils/Path.h>
 
 #include <filament/Camera.h>
@@ -33,6 +37,7 @@
 #include <filament/RenderableManager.h>
 #include <filament/Scene.h>
 #include <filament/Skybox.h>
+#include <filament/SwapChain.h>
 #include <filament/View.h>
 
 #ifndef NDEBUG
@@ -44,20 +49,65 @@
 #include <filagui/ImGuiHelper.h>
 
 #include <filamentappwayland/Cube.h>
+#include <filamentappwayland/MeshAssimp.h>
+#include <filamentappwayland/ResourceStats.h>
+#include <filamentappwayland/TraceRecorder.h>
 
-#include <stb_image.h>
-
-#include "generated/resources/filamentappwl.h"
 
 using namespace filament;
 using namespace filagui;
 using namespace filament::math;
 using namespace utils;
 
-FilamentAppWayland &FilamentAppWayland::get() {
-    static FilamentAppWayland filamentApp;
-    return filamentApp;
-}
+namespace {
+    int64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+        return int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+
+    // The swap chain extent callback is a plain function pointer without user data, so each
+    // window gets one of a fixed set of callbacks reading its size from a matching slot.
+    // Sizes are packed as (width << 32 | height) since the driver may query them from its thread.
+    constexpr size_t kExtentSlotCount = 8;
+    std::atomic<uint64_t> sExtents[kExtentSlotCount];
+    std::atomic<bool> sExtentSlotUsed[kExtentSlotCount];
+
+    template<size_t I>
+    void extentCallback(uint32_t *width, uint32_t *height) {
+        uint64_t extent = sExtents[I].load(std::memory_order_relaxed);
+        *width = uint32_t(extent >> 32);
+        *height = uint32_t(extent);
+    }
+
+    template<size_t... I>
+    constexpr std::array<Engine::SwapChainExtentVoidCallback, sizeof...(I)>
+    makeExtentCallbacks(std::index_sequence<I...>) {
+        return {&extentCallback<I>...};
+    }
+
+    constexpr auto sExtentCallbacks = makeExtentCallbacks(std::make_index_sequence<kExtentSlotCount>());
+
+    size_t acquireExtentSlot() {
+        for (size_t i = 0; i < kExtentSlotCount; i++) {
+            if (!sExtentSlotUsed[i].exchange(true)) {
+                return i;
+            }
+        }
+        return kExtentSlotCount;
+    }
+
+    void setExtent(size_t slot, size_t width, size_t height) {
+        if (slot < kExtentSlotCount) {
+            sExtents[slot].store(uint64_t(width) << 32 | uint32_t(height), std::memory_order_relaxed);
+        }
+    }
+
+    void releaseExtentSlot(size_t slot) {
+        if (slot < kExtentSlotCount) {
+            sExtentSlotUsed[slot].store(false);
+        }
+    }
+} // namespace
 
 FilamentAppWayland::FilamentAppWayland() {
 
@@ -75,93 +125,195 @@ void FilamentAppWayland::run(void *data, const Config &config, size_t width, siz
                              SetupCallback setupCallback, CleanupCallback cleanupCallback,
                              ImGuiCallback imguiCallback, PreRenderCallback preRender,
                              PostRenderCallback postRender) {
+    runAsync(data, config, width, height, std::move(setupCallback), std::move(cleanupCallback),
+             ReadyCallback(), std::move(imguiCallback), std::move(preRender), std::move(postRender));
+
+    while (!isReady()) {
+        advanceLoading(true);
+    }
+}
+
+void FilamentAppWayland::runAsync(void *data, const Config &config, size_t width, size_t height,
+                                  SetupCallback setupCallback, CleanupCallback cleanupCallback,
+                                  ReadyCallback readyCallback, ImGuiCallback imguiCallback,
+                                  PreRenderCallback preRender, PostRenderCallback postRender) {
+    mAppSetupCallback = std::move(setupCallback);
+    mAppReadyCallback = std::move(readyCallback);
     mAppPreRenderCallback = std::move(preRender);
     mAppPostRenderCallback = std::move(postRender);
     mAppCleanupCallback = std::move(cleanupCallback);
     mAppImgGuiCallback = std::move(imguiCallback);
 
-    mWindowTitle = config.title;
-    std::unique_ptr<FilamentAppWayland::Window> window(
-            new FilamentAppWayland::Window(this, config, config.title, width, height));
-    mAppWindow = std::move(window);
+    mData = data;
+    mConfig = config;
+    if (!mConfig.hasDebugViews()) {
+        mConfig.splitView = false;
+    }
+    mInitialWidth = width;
+    mInitialHeight = height;
+
+    // File I/O and KTX parsing don't need the engine; overlap them with engine creation.
+    std::string iblDirectory = config.iblDirectory;
+    mIBLPayload = std::async(std::launch::async, [iblDirectory]() -> std::unique_ptr<IBL::KtxPayload> {
+        if (iblDirectory.empty()) {
+            return nullptr;
+        }
+        return IBL::prefetchFromDirectory(Path(iblDirectory));
+    });
 
-    mDepthMaterial = Material::Builder()
-            .package(FILAMENTAPPWL_DEPTHVISUALIZER_DATA, FILAMENTAPPWL_DEPTHVISUALIZER_SIZE)
-            .build(*mEngine);
+    mLoadState = LoadState::CREATE_ENGINE;
 
-    mDepthMI = mDepthMaterial->createInstance();
+    mTasks.post([this]() {
+        if (!advanceLoading(false)) {
+            return isReady() ? TaskQueue::Status::DONE : TaskQueue::Status::BLOCKED;
+        }
+        return isReady() ? TaskQueue::Status::DONE : TaskQueue::Status::PENDING;
+    }, TaskQueue::Priority::HIGH);
+}
 
-    mDefaultMaterial = Material::Builder()
-            .package(FILAMENTAPPWL_AIDEFAULTMAT_DATA, FILAMENTAPPWL_AIDEFAULTMAT_SIZE)
-            .build(*mEngine);
+bool FilamentAppWayland::advanceLoading(bool wait) {
+    switch (mLoadState) {
+        case LoadState::IDLE:
+        case LoadState::READY:
+            return false;
 
-    mTransparentMaterial = Material::Builder()
-            .package(FILAMENTAPPWL_TRANSPARENTCOLOR_DATA, FILAMENTAPPWL_TRANSPARENTCOLOR_SIZE)
-            .build(*mEngine);
+        case LoadState::CREATE_ENGINE:
+            // The engine, its JobSystem and the shared materials are owned by every context in
+            // this process; only the first call actually creates them.
+            mSharedEngine = SharedEngine::acquire(mConfig);
+            mEngine = mSharedEngine->getEngine();
+            mPipeline.setEngine(mEngine);
+            mGpuTimer.setEngine(mEngine);
+            mLoadState = LoadState::CREATE_WINDOW;
+            return true;
 
-    std::unique_ptr<Cube> cameraCube(new Cube(*mEngine, mTransparentMaterial, {1, 0, 0}));
-    mAppCameraCube = std::move(cameraCube);
-    // we can't cull the light-frustum because it's not applied a rigid transform
-    // and currently, filament assumes that for culling
-    std::unique_ptr<Cube> lightmapCube(new Cube(*mEngine, mTransparentMaterial, {0, 1, 0}, false));
-    mAppLightmapCube = std::move(lightmapCube);
-    mScene = mEngine->createScene();
+        case LoadState::CREATE_WINDOW: {
+            auto const &config = mConfig;
+
+            mWindowTitle = config.title;
+            std::unique_ptr<FilamentAppWayland::Window> window(
+                    new FilamentAppWayland::Window(this, config, config.title, mInitialWidth, mInitialHeight));
+            mAppWindow = std::move(window);
+
+            if (config.hasDebugViews()) {
+                {
+                    TraceRecorder::Scope trace("material instance", "material");
+                    mDepthMI = mSharedEngine->getDepthMaterial()->createInstance();
+                }
+
+                auto transparentMaterial = mSharedEngine->getTransparentMaterial();
+                std::unique_ptr<Cube> cameraCube(new Cube(*mEngine, transparentMaterial, {1, 0, 0}));
+                mAppCameraCube = std::move(cameraCube);
+                // we can't cull the light-frustum because it's not applied a rigid transform
+                // and currently, filament assumes that for culling
+                std::unique_ptr<Cube> lightmapCube(new Cube(*mEngine, transparentMaterial, {0, 1, 0}, false));
+                mAppLightmapCube = std::move(lightmapCube);
+            }
+            mScene = mEngine->createScene();
 
-    mAppWindow->mMainView->getView()->setVisibleLayers(0x4, 0x4);
+            mAppWindow->mMainView->getView()->setVisibleLayers(0x4, 0x4);
 
-    if (config.splitView) {
-        auto &rcm = mEngine->getRenderableManager();
+            if (config.splitView) {
+                auto &rcm = mEngine->getRenderableManager();
 
-        rcm.setLayerMask(rcm.getInstance(mAppCameraCube->getSolidRenderable()), 0x3, 0x2);
-        rcm.setLayerMask(rcm.getInstance(mAppCameraCube->getWireFrameRenderable()), 0x3, 0x2);
+                rcm.setLayerMask(rcm.getInstance(mAppCameraCube->getSolidRenderable()), 0x3, 0x2);
+                rcm.setLayerMask(rcm.getInstance(mAppCameraCube->getWireFrameRenderable()), 0x3, 0x2);
 
-        rcm.setLayerMask(rcm.getInstance(mAppLightmapCube->getSolidRenderable()), 0x3, 0x2);
-        rcm.setLayerMask(rcm.getInstance(mAppLightmapCube->getWireFrameRenderable()), 0x3, 0x2);
+                rcm.setLayerMask(rcm.getInstance(mAppLightmapCube->getSolidRenderable()), 0x3, 0x2);
+                rcm.setLayerMask(rcm.getInstance(mAppLightmapCube->getWireFrameRenderable()), 0x3, 0x2);
 
-        // Create the camera mesh
-        mScene->addEntity(mAppCameraCube->getWireFrameRenderable());
-        mScene->addEntity(mAppCameraCube->getSolidRenderable());
+                // Create the camera mesh
+                mScene->addEntity(mAppCameraCube->getWireFrameRenderable());
+                mScene->addEntity(mAppCameraCube->getSolidRenderable());
 
-        mScene->addEntity(mAppLightmapCube->getWireFrameRenderable());
-        mScene->addEntity(mAppLightmapCube->getSolidRenderable());
+                mScene->addEntity(mAppLightmapCube->getWireFrameRenderable());
+                mScene->addEntity(mAppLightmapCube->getSolidRenderable());
 
-        mAppWindow->mDepthView->getView()->setVisibleLayers(0x4, 0x4);
-        mAppWindow->mGodView->getView()->setVisibleLayers(0x6, 0x6);
-        mAppWindow->mOrthoView->getView()->setVisibleLayers(0x6, 0x6);
+                mAppWindow->mDepthView->getView()->setVisibleLayers(0x4, 0x4);
+                mAppWindow->mGodView->getView()->setVisibleLayers(0x6, 0x6);
+                mAppWindow->mOrthoView->getView()->setVisibleLayers(0x6, 0x6);
 
-        // only preserve the color buffer for additional views; depth and stencil can be discarded.
-        mAppWindow->mDepthView->getView()->setShadowingEnabled(false);
-        mAppWindow->mGodView->getView()->setShadowingEnabled(false);
-        mAppWindow->mOrthoView->getView()->setShadowingEnabled(false);
-    }
+                // only preserve the color buffer for additional views; depth and stencil can be discarded.
+                mAppWindow->mDepthView->getView()->setShadowingEnabled(false);
+                mAppWindow->mGodView->getView()->setShadowingEnabled(false);
+                mAppWindow->mOrthoView->getView()->setShadowingEnabled(false);
+            }
 
-    loadDirt(config);
-    loadIBL(config);
-    if (mIBL != nullptr) {
-        mIBL->getSkybox()->setLayerMask(0x7, 0x4);
-        mScene->setSkybox(mIBL->getSkybox());
-        mScene->setIndirectLight(mIBL->getIndirectLight());
-    }
+            for (auto &view: mAppWindow->mViews) {
+                view->getView()->setScene(mScene);
+            }
 
-    for (auto &view: mAppWindow->mViews) {
-        view->getView()->setScene(mScene);
-    }
+            loadDirt(config);
+            mLoadState = LoadState::LOAD_IBL;
+            return true;
+        }
 
-    setupCallback(data, mEngine, mAppWindow->mMainView->getView(), mScene);
+        case LoadState::LOAD_IBL: {
+            if (!wait && mIBLPayload.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
+            std::unique_ptr<IBL::KtxPayload> payload = mIBLPayload.get();
+            loadIBL(mConfig, payload.get());
+            if (mIBL != nullptr) {
+                mIBL->getSkybox()->setLayerMask(0x7, 0x4);
+                mScene->setSkybox(mIBL->getSkybox());
+                mScene->setIndirectLight(mIBL->getIndirectLight());
+                mDirty |= DIRTY_IBL;
+            }
+            mLoadState = LoadState::SETUP;
+            return true;
+        }
+
+        case LoadState::SETUP:
+            mAppSetupCallback(mData, mEngine, mAppWindow->mMainView->getView(), mScene);
+
+            mAppCameraFocalLength = mCameraFocalLength;
 
+            std::cout << "Timer Latency: " << Timer_t::TestLatency().count() << std::endl;
 
-    mAppCameraFocalLength = mCameraFocalLength;
+            mFrameClock.reset();
+            mDirty = DIRTY_ALL;
 
-    std::cout << "Timer Latency: " << mTimer.TestLatency().count() << std::endl;
+            mLoadState = LoadState::READY;
+            if (mAppReadyCallback) {
+                mAppReadyCallback(mData);
+            }
+            return true;
+    }
+    return false;
+}
 
-    mTimer.Start();
+void FilamentAppWayland::setWindowSize(size_t width, size_t height) {
+    if (!mAppWindow) {
+        // still loading, the window will be created with the latest size
+        mInitialWidth = width;
+        mInitialHeight = height;
+        return;
+    }
+    mPendingWidth = width;
+    mPendingHeight = height;
+    mResizePending = true;
 }
 
-void FilamentAppWayland::run_task() {
+size_t FilamentAppWayland::run_task(std::chrono::microseconds budget) {
+    return mTasks.run(budget);
 }
 
-void FilamentAppWayland::draw_frame(uint32_t time) {
-    (void)time;
+bool FilamentAppWayland::draw_frame(uint32_t time) {
+    // Nothing to show until loading has finished, see runAsync().
+    if (!isReady()) {
+        return false;
+    }
+
+    TraceRecorder::Scope trace("draw_frame", "frame");
+    const auto frameStart = std::chrono::steady_clock::now();
+    mFrameClock.tick(time);
+
+    // Frame rate cap, declined ticks don't touch the scene at all.
+    if (!mPacer.shouldRender(mFrameClock)) {
+        publishStats();
+        return false;
+    }
 
     auto& window = mAppWindow;
     auto& preRender = mAppPreRenderCallback;
@@ -170,150 +322,452 @@ void FilamentAppWayland::draw_frame(uint32_t time) {
     auto& cameraCube = mAppCameraCube;
     auto& imguiCallback = mAppImgGuiCallback;
 
+    // Apply at most one resize per frame, however many were requested since the last one.
+    if (mResizePending) {
+        mResizePending = false;
+        if (mPendingWidth != window->mWidth || mPendingHeight != window->mHeight) {
+            window->setSize(mPendingWidth, mPendingHeight);
+            mSwapChainRecreations++;
+            mDirty |= DIRTY_VIEWPORT;
+        }
+    }
+
     if (mCameraFocalLength != mAppCameraFocalLength) {
       window->configureCamerasForWindow();
         mAppCameraFocalLength = mCameraFocalLength;
+        mDirty |= DIRTY_CAMERA;
     }
 
     if (!UTILS_HAS_THREADING) {
+        auto scope = mPhases.scope(PhaseTimings::Phase::EXECUTE);
         mEngine->execute();
     }
 
-    // Allow the app to animate the scene if desired.
-    if (mAnimation) {
-        auto now = std::chrono::steady_clock::now();
-        std::chrono::time_point<std::chrono::steady_clock, std::chrono::duration<double, std::milli>> now1 = now;
-        auto now2 = now1.time_since_epoch().count() / 1000.0f;
-        mAnimation(this, mEngine, window->mMainView->getView(), now2);
-    }
-
-    // Calculate the time step.
-    mTimer.End();
-    mTimer.CalcDuration();
-    auto duration = mTimer.GetDuration() / 1000000.0f;
-    const float timeStep = duration.count();
-    mTimer.Start();
-
-    // Update the camera manipulators for each view.
-    for (auto const& view : window->mViews) {
-        auto* cm = view->getCameraManipulator();
-        if (cm) {
-            cm->update(timeStep);
+    // Throttle before any input is sampled, so a frame that waited still shows the latest state.
+    const auto maxWait = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::duration<double>(mFrameClock.refreshInterval()));
+    if (!mPipeline.acquire(maxWait)) {
+        publishStats();
+        return false;
+    }
+
+    // glTF materials that finished building replace their placeholders before the scene update.
+    for (MeshAssimp *mesh: mMeshes) {
+        bool swapped = false;
+        mesh->updateMaterials(&swapped);
+        if (swapped) {
+            mDirty |= DIRTY_MATERIAL;
         }
     }
 
-    // Update the position and orientation of the two cameras.
-    filament::math::float3 eye, center, up;
-    window->mMainCameraMan->getLookAt(&eye, &center, &up);
-    window->mMainCamera->lookAt(eye, center, up);
-    window->mDebugCameraMan->getLookAt(&eye, &center, &up);
-    window->mDebugCamera->lookAt(eye, center, up);
+    // Animations change the scene every frame, clear the animator and use animate(nullptr) to let
+    // the surface go idle.
+    updateScene(mFrameClock.frameTime(), mFrameClock.delta());
+    if (!mAnimator.empty() || mAnimation) {
+        mDirty |= DIRTY_TRANSFORM;
+    }
 
-    // Update the cube distortion matrix used for frustum visualization.
-    const Camera* lightmapCamera = window->mMainView->getView()->getDirectionalLightCamera();
-    lightmapCube->mapFrustum(*mEngine, lightmapCamera);
-    cameraCube->mapFrustum(*mEngine, window->mMainCamera);
+    // Update the position and orientation of the two cameras, only if they actually moved.
+    auto updateCamera = [this](CameraManipulator *cm, Camera *camera, float3 *lookAt) {
+        filament::math::float3 eye, center, up;
+        cm->getLookAt(&eye, &center, &up);
+        if (eye != lookAt[0] || center != lookAt[1] || up != lookAt[2]) {
+            lookAt[0] = eye;
+            lookAt[1] = center;
+            lookAt[2] = up;
+            camera->lookAt(eye, center, up);
+            mDirty |= DIRTY_CAMERA;
+        }
+    };
+    updateCamera(window->mMainCameraMan, window->mMainCamera, mMainLookAt);
+    if (mConfig.splitView) {
+        updateCamera(window->mDebugCameraMan, window->mDebugCamera, mDebugLookAt);
+    }
+
+    // Skip the frame when none of its inputs changed. A few frames are still rendered after the
+    // last change so the frames in flight and temporal effects settle on the final image.
+    if ((mDirty & DIRTY_SCENE) || mSceneStatsAge >= kSceneStatsInterval) {
+        updateSceneStats();
+    }
+    const uint32_t dirty = mDirty;
+    if (mDirty) {
+        // Latched per view, beginFrame() may still refuse this frame.
+        if (dirty & ~DIRTY_OFFSCREEN) {
+            for (auto &offscreen: mOffscreenViews) {
+                offscreen.dirty |= offscreen.update == OffscreenUpdate::WHEN_DIRTY;
+            }
+        }
+        mDirty = 0;
+        mSettleFrames = kSettleFrameCount;
+    } else if (mIdleElision) {
+        if (mSettleFrames == 0) {
+            ++mIdleFrames;
+            publishStats();
+            return false;
+        }
+        --mSettleFrames;
+    }
+
+    // HIGH_THROUGHPUT only waits for the GPU now, the scene update above overlapped its work.
+    if (!mPipeline.reserve(maxWait)) {
+        mDirty |= dirty;
+        publishStats();
+        return false;
+    }
+
+    // Update the cube distortion matrix used for frustum visualization, only shown in split view.
+    if (mConfig.splitView) {
+        auto scope = mPhases.scope(PhaseTimings::Phase::FRUSTUM);
+        const Camera* lightmapCamera = window->mMainView->getView()->getDirectionalLightCamera();
+        lightmapCube->mapFrustum(*mEngine, lightmapCamera);
+        cameraCube->mapFrustum(*mEngine, window->mMainCamera);
+    }
 
 
     Renderer* renderer = window->getRenderer();
 
+    // Let filament's frame skipping and dynamic resolution work against the paced frame time.
+    if (mPacer.consumeChanged()) {
+        Renderer::DisplayInfo displayInfo;
+        displayInfo.refreshRate = mPacer.getRefreshRate();
+        renderer->setDisplayInfo(displayInfo);
+        Renderer::FrameRateOptions frameRateOptions;
+        frameRateOptions.interval = uint8_t(mPacer.getInterval());
+        renderer->setFrameRateOptions(frameRateOptions);
+    }
+
     if (preRender) {
         preRender(mEngine, window->mViews[0]->getView(), mScene, renderer);
     }
 
     if (renderer->beginFrame(window->getSwapChain())) {
-        for (filament::View* offscreenView : mOffscreenViews) {
-            renderer->render(offscreenView);
+        if (!mOffscreenViews.empty()) {
+            auto scope = mPhases.scope(PhaseTimings::Phase::OFFSCREEN_VIEWS);
+            renderOffscreenViews(renderer);
         }
-        for (auto const& view : window->mViews) {
-            renderer->render(view->getView());
+        for (size_t i = 0; i < window->mViews.size(); i++) {
+            if (i < PhaseTimings::MAX_VIEWS) {
+                auto scope = mPhases.scope(PhaseTimings::view(i));
+                renderer->render(window->mViews[i]->getView());
+            } else {
+                renderer->render(window->mViews[i]->getView());
+            }
         }
         if (postRender) {
             postRender(mEngine, window->mViews[0]->getView(), mScene, renderer);
         }
-        renderer->endFrame();
+        if (mReadback) {
+            mReadback->readFrame(renderer, uint32_t(window->mWidth), uint32_t(window->mHeight));
+        }
+        {
+            auto scope = mPhases.scope(PhaseTimings::Phase::END_FRAME);
+            renderer->endFrame();
+        }
+        mPipeline.submitted();
+        mGpuTimer.submitted();
+
+        const std::chrono::duration<float, std::milli> cpuTime =
+                std::chrono::steady_clock::now() - frameStart;
+        mStats.edit().framesRendered++;
+        mStats.addFrameTime(cpuTime.count());
+        mPhases.record(PhaseTimings::Phase::FRAME,
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(cpuTime));
+
+        const double frameInterval = mFrameClock.now() - mLastRenderedTime;
+        mLastRenderedTime = mFrameClock.now();
+        if (mGovernor.update(*mEngine, window->mMainView->getView(), mScene, cpuTime.count(),
+                             mGpuTimer.getFrameMs(), frameInterval, mPacer.getTargetFrameTime(),
+                             (dirty & DIRTY_SCENE) != 0)) {
+            mDirty |= DIRTY_VIEWPORT;
+        }
+        mSceneStatsAge++;
+        publishStats();
+        return true;
+    }
 
-    } else {
-        ++mSkippedFrames;
+    ++mSkippedFrames;
+    publishStats();
+    return false;
+}
+
+void FilamentAppWayland::addOffscreenView(View *view, OffscreenUpdate update, uint32_t interval) {
+    mOffscreenViews.push_back({ view, update, std::max(interval, 1u), 0, true });
+    mDirty |= DIRTY_SCENE;
+}
+
+void FilamentAppWayland::addMesh(MeshAssimp *mesh) {
+    if (std::find(mMeshes.begin(), mMeshes.end(), mesh) == mMeshes.end()) {
+        mMeshes.push_back(mesh);
     }
 }
 
-void FilamentAppWayland::stop() {
-    if (mImGuiHelper) {
-        mImGuiHelper.reset();
+void FilamentAppWayland::removeMesh(MeshAssimp *mesh) {
+    mMeshes.erase(std::remove(mMeshes.begin(), mMeshes.end(), mesh), mMeshes.end());
+}
+
+void FilamentAppWayland::removeOffscreenView(View *view) {
+    mOffscreenViews.erase(std::remove_if(mOffscreenViews.begin(), mOffscreenViews.end(),
+                                         [view](auto const &offscreen) {
+                                             return offscreen.view == view;
+                                         }), mOffscreenViews.end());
+    mDirty |= DIRTY_SCENE;
+}
+
+void FilamentAppWayland::setOffscreenViewUpdate(View *view, OffscreenUpdate update,
+                                                uint32_t interval) {
+    for (auto &offscreen: mOffscreenViews) {
+        if (offscreen.view == view) {
+            offscreen.update = update;
+            offscreen.interval = std::max(interval, 1u);
+        }
     }
+}
 
-    mAppCleanupCallback(this, mEngine, mAppWindow->mMainView->getView(), mScene);
+void FilamentAppWayland::markOffscreenViewDirty(View *view) {
+    for (auto &offscreen: mOffscreenViews) {
+        if (offscreen.view == view) {
+            offscreen.dirty = true;
+            mDirty |= DIRTY_OFFSCREEN;
+        }
+    }
+}
 
-    mAppCameraCube.reset();
-    mAppLightmapCube.reset();
-    mAppWindow.reset();
+void FilamentAppWayland::renderOffscreenViews(Renderer *renderer) {
+    for (auto &offscreen: mOffscreenViews) {
+        offscreen.age++;
+        bool render = offscreen.dirty;
+        switch (offscreen.update) {
+            case OffscreenUpdate::EVERY_FRAME:
+                render = true;
+                break;
+            case OffscreenUpdate::EVERY_NTH_FRAME:
+                render |= offscreen.age >= offscreen.interval;
+                break;
+            case OffscreenUpdate::WHEN_DIRTY:  // changes are latched into dirty by draw_frame()
+            case OffscreenUpdate::ONCE:
+                break;
+        }
+        // Nothing else draws into the view's render target, skipping it keeps the last result.
+        if (render) {
+            renderer->render(offscreen.view);
+            offscreen.age = 0;
+            offscreen.dirty = false;
+        }
+    }
+}
 
-    mIBL.reset();
-    mEngine->destroy(mDepthMI);
-    mEngine->destroy(mDepthMaterial);
-    mEngine->destroy(mDefaultMaterial);
-    mEngine->destroy(mTransparentMaterial);
-    mEngine->destroy(mScene);
-    Engine::destroy(&mEngine);
-    mEngine = nullptr;
+void FilamentAppWayland::setPerformanceGovernor(bool enabled, float thermalLimit) {
+    if (!enabled && mGovernor.isEnabled() && mAppWindow) {
+        mGovernor.restore(*mEngine, mAppWindow->mMainView->getView());
+        mDirty |= DIRTY_VIEWPORT;
+    }
+    mGovernor.setEnabled(enabled);
+    mGovernor.setThermalLimit(thermalLimit);
 }
 
-void FilamentAppWayland::loadIBL(const Config &config) {
-    if (!config.iblDirectory.empty()) {
-        Path iblPath(config.iblDirectory);
+void FilamentAppWayland::updateScene(double time, float timeStep) {
+    using Clock = std::chrono::steady_clock;
+    TraceRecorder::Scope trace("update", "frame");
+    const auto updateStart = Clock::now();
+
+    // The main and depth views share a manipulator, it must only be updated once.
+    std::vector<CameraManipulator *> manipulators;
+    for (auto const &view: mAppWindow->mViews) {
+        auto *cm = view->getCameraManipulator();
+        if (cm && std::find(manipulators.begin(), manipulators.end(), cm) == manipulators.end()) {
+            manipulators.push_back(cm);
+        }
+    }
 
-        if (!iblPath.exists()) {
-            std::cerr << "The specified IBL path does not exist: " << iblPath << std::endl;
-            return;
+    const size_t animatedCount = mAnimator.size();
+    mAnimatedTransforms.resize(animatedCount);
+
+    // Job captures have to fit in a job's storage, they only reference this.
+    struct {
+        std::atomic<int64_t> animationNs{0};
+        std::atomic<int64_t> manipulatorNs{0};
+        std::atomic<uint32_t> jobCount{0};
+    } timing;
+
+    if (UTILS_HAS_THREADING) {
+        auto &js = mEngine->getJobSystem();
+        JobSystem::Job *root = js.createJob();
+
+        if (animatedCount) {
+            auto *animate = jobs::parallel_for(js, root, 0, uint32_t(animatedCount),
+                    [this, time, &timing](uint32_t start, uint32_t count) {
+                        TraceRecorder::Scope trace("animation job", "frame");
+                        const auto jobStart = Clock::now();
+                        mAnimator.evaluate(time, start, count, mAnimatedTransforms.data() + start);
+                        timing.animationNs.fetch_add(elapsedNs(jobStart), std::memory_order_relaxed);
+                        timing.jobCount.fetch_add(1, std::memory_order_relaxed);
+                    }, jobs::CountSplitter<kAnimatorBatchSize>());
+            js.run(animate);
         }
 
-        mIBL = std::make_unique<IBL>(*mEngine);
+        for (auto *cm: manipulators) {
+            auto *update = js.createJob(root,
+                    [cm, timeStep, &timing](JobSystem &, JobSystem::Job *) {
+                        TraceRecorder::Scope trace("manipulator job", "frame");
+                        const auto jobStart = Clock::now();
+                        cm->update(timeStep);
+                        timing.manipulatorNs.fetch_add(elapsedNs(jobStart), std::memory_order_relaxed);
+                        timing.jobCount.fetch_add(1, std::memory_order_relaxed);
+                    });
+            js.run(update);
+        }
 
-        if (!iblPath.isDirectory()) {
-            if (!mIBL->loadFromEquirect(iblPath)) {
-                std::cerr << "Could not load the specified IBL: " << iblPath << std::endl;
-                mIBL.reset(nullptr);
-                return;
-            }
-        } else {
-            if (!mIBL->loadFromDirectory(iblPath)) {
-                std::cerr << "Could not load the specified IBL: " << iblPath << std::endl;
-                mIBL.reset(nullptr);
-                return;
-            }
+        // This thread helps with the jobs until they are all done.
+        js.runAndWait(root);
+    } else {
+        const auto animationStart = Clock::now();
+        mAnimator.evaluate(time, 0, animatedCount, mAnimatedTransforms.data());
+        timing.animationNs = elapsedNs(animationStart);
+
+        const auto manipulatorStart = Clock::now();
+        for (auto *cm: manipulators) {
+            cm->update(timeStep);
         }
+        timing.manipulatorNs = elapsedNs(manipulatorStart);
+    }
+
+    // The transform manager isn't thread safe, the results are applied in one transaction here.
+    // The app's callback may use any engine API, so it runs on this thread after the join too.
+    const auto applyStart = Clock::now();
+    if (animatedCount) {
+        mAnimator.apply(mEngine->getTransformManager(), mAnimatedTransforms.data());
+    }
+    if (mAnimation) {
+        TraceRecorder::Scope callbackTrace("animation callback", "frame");
+        mAnimation(mData, mEngine, mAppWindow->mMainView->getView(), time);
     }
+    const int64_t applyNs = elapsedNs(applyStart);
+
+    using Phase = PhaseTimings::Phase;
+    mPhases.record(Phase::UPDATE, Clock::now() - updateStart);
+    if (animatedCount || mAnimation) {
+        mPhases.record(Phase::ANIMATION, std::chrono::nanoseconds(timing.animationNs + applyNs));
+    }
+    if (!manipulators.empty()) {
+        mPhases.record(Phase::MANIPULATORS, std::chrono::nanoseconds(timing.manipulatorNs));
+    }
+
+    auto &stats = mStats.edit();
+    stats.updateMs = float(elapsedNs(updateStart)) * 1e-6f;
+    stats.animationJobMs = float(timing.animationNs.load()) * 1e-6f;
+    stats.manipulatorJobMs = float(timing.manipulatorNs.load()) * 1e-6f;
+    stats.updateJobCount = timing.jobCount.load();
 }
 
-void FilamentAppWayland::loadDirt(const Config &config) {
-    if (!config.dirt.empty()) {
-        Path dirtPath(config.dirt);
+void FilamentAppWayland::updateSceneStats() {
+    mSceneStatsAge = 0;
 
-        if (!dirtPath.exists()) {
-            std::cerr << "The specified dirt file does not exist: " << dirtPath << std::endl;
-            return;
+    auto &rcm = mEngine->getRenderableManager();
+    auto countPrimitives = [&rcm](const Scene *scene) {
+        uint32_t count = 0;
+        scene->forEach([&rcm, &count](Entity entity) {
+            auto instance = rcm.getInstance(entity);
+            if (instance) {
+                count += uint32_t(rcm.getPrimitiveCount(instance));
+            }
+        });
+        return count;
+    };
+
+    // Upper bound, culling isn't taken into account.
+    uint32_t drawCount = 0;
+    for (auto const &offscreen: mOffscreenViews) {
+        if (offscreen.view->getScene()) {
+            drawCount += countPrimitives(offscreen.view->getScene());
         }
-
-        if (!dirtPath.isFile()) {
-            std::cerr << "The specified dirt path is not a file: " << dirtPath << std::endl;
-            return;
+    }
+    const uint32_t scenePrimitives = countPrimitives(mScene);
+    for (auto const &view: mAppWindow->mViews) {
+        if (view->getView()->getScene() == mScene) {
+            drawCount += scenePrimitives;
         }
+    }
+
+    auto &stats = mStats.edit();
+    stats.entityCount = uint32_t(mScene->getEntityCount());
+    stats.renderableCount = uint32_t(mScene->getRenderableCount());
+    stats.drawCount = drawCount;
+}
+
+void FilamentAppWayland::publishStats() {
+    using Kind = ResourceStats::Kind;
+    auto &stats = mStats.edit();
+    stats.framesSkipped = mSkippedFrames;
+    stats.framesThrottled = mPipeline.getThrottledFrameCount();
+    stats.framesIdle = mIdleFrames;
+    stats.framesEarly = mFrameClock.getEarlyFrameCount();
+    stats.swapChainRecreations = mSwapChainRecreations;
+    stats.framesPaced = mPacer.getPacedFrameCount();
+    stats.targetFrameMs = float(mPacer.getTargetFrameTime() * 1000.0);
+    stats.qualityLevel = mGovernor.getLevel();
+    stats.temperature = mGovernor.getTemperature();
+    stats.meshCpuBytes = ResourceStats::getCpuBytes(Kind::MESH);
+    stats.meshGpuBytes = ResourceStats::getGpuBytes(Kind::MESH);
+    stats.textureCpuBytes = ResourceStats::getCpuBytes(Kind::TEXTURE);
+    stats.textureGpuBytes = ResourceStats::getGpuBytes(Kind::TEXTURE);
+    stats.materialCpuBytes = ResourceStats::getCpuBytes(Kind::MATERIAL);
+    stats.materialGpuBytes = ResourceStats::getGpuBytes(Kind::MATERIAL);
+    mStats.publish();
+}
+
+void FilamentAppWayland::stop() {
+    if (mImGuiHelper) {
+        mImGuiHelper.reset();
+    }
 
-        int w, h, n;
+    // queued work refers to objects destroyed below
+    mTasks.clear();
+    mMeshes.clear();
 
-        unsigned char *data = stbi_load(dirtPath.getAbsolutePath().c_str(), &w, &h, &n, 3);
-        assert(n == 3);
+    // stop() may be called while still loading; the worker has to finish before we go away
+    if (mIBLPayload.valid()) {
+        mIBLPayload.wait();
+    }
 
-        mDirt = Texture::Builder()
-                .width(w)
-                .height(h)
-                .format(Texture::InternalFormat::RGB8)
-                .build(*mEngine);
+    mAnimator.clear();
+    if (mLoadState == LoadState::READY) {
+        mAppCleanupCallback(mData, mEngine, mAppWindow->mMainView->getView(), mScene);
+    }
+    mLoadState = LoadState::IDLE;
 
-        mDirt->setImage(*mEngine, 0, {data, size_t(w * h * 3),
-                                      Texture::Format::RGB, Texture::Type::UBYTE,
-                                      (Texture::PixelBufferDescriptor::Callback) &stbi_image_free});
+    if (mAppWindow) {
+        mGovernor.restore(*mEngine, mAppWindow->mMainView->getView());
+    }
+    mReadback.reset();
+    mAppCameraCube.reset();
+    mAppLightmapCube.reset();
+    mAppWindow.reset();
+
+    mIBL = nullptr;
+    mDirt = nullptr;
+    if (mEngine) {
+        mEngine->destroy(mDepthMI);
+        mEngine->destroy(mScene);
+        mPipeline.setEngine(nullptr);
+        mGpuTimer.setEngine(nullptr);
+        mEngine = nullptr;
+    }
+    mDepthMI = nullptr;
+    mScene = nullptr;
+
+    // the engine goes away with the last context
+    mSharedEngine.reset();
+}
+
+void FilamentAppWayland::loadIBL(const Config &config, IBL::KtxPayload *payload) {
+    if (!config.iblDirectory.empty()) {
+        mIBL = mSharedEngine->getIBL(config.iblDirectory, payload);
+    }
+}
+
+void FilamentAppWayland::loadDirt(const Config &config) {
+    if (!config.dirt.empty()) {
+        mDirt = mSharedEngine->getDirt(config.dirt);
     }
 }
 
@@ -323,21 +777,19 @@ FilamentAppWayland::Window::Window(FilamentAppWayland *filamentApp,
                                    const Config &config, std::string title, size_t w, size_t h)
         : mFilamentApp(filamentApp), mIsHeadless(config.headless), mWidth(w), mHeight(h) {
 
+    // The engine itself is shared between windows, see SharedEngine.
+    mBackend = mFilamentApp->mSharedEngine->getBackend();
+
+    mNativeWindow = config.native_window;
+    mExtentSlot = mIsHeadless ? kExtentSlotCount : acquireExtentSlot();
+    setExtent(mExtentSlot, w, h);
+
     if (config.headless) {
-        mFilamentApp->mEngine = Engine::create(config.backend);
-        mSwapChain = mFilamentApp->mEngine->createSwapChain((uint32_t) w, (uint32_t) h);
+        mSwapChain = createSwapChain();
         mWidth = w;
         mHeight = h;
     } else {
 
-        // Create the Engine after the window in case this happens to be a single-threaded platform.
-        // For single-threaded platforms, we need to ensure that Filament's OpenGL context is
-        // current, rather than the one created by SDL.
-        mFilamentApp->mEngine = Engine::create(config.backend);
-
-        // get the resolved backend
-        mBackend = config.backend = mFilamentApp->mEngine->getBackend();
-
 #if defined(__APPLE__)
         ::prepareNativeWindow(mWindow);
 
@@ -356,25 +808,23 @@ FilamentAppWayland::Window::Window(FilamentAppWayland *filamentApp,
 #endif
 #endif
 
-        // Select the feature level to use
-        config.featureLevel = std::min(config.featureLevel,
-                                       mFilamentApp->mEngine->getSupportedFeatureLevel());
-        mFilamentApp->mEngine->setActiveFeatureLevel(config.featureLevel);
-
-        mSwapChain = mFilamentApp->mEngine->createSwapChain(config.native_window);
+        mSwapChain = createSwapChain();
     }
     mRenderer = mFilamentApp->mEngine->createRenderer();
 
-    // create cameras
+    // create cameras, only the main one without debug views
     utils::EntityManager &em = utils::EntityManager::get();
-    em.create(3, mCameraEntities);
+    mCameraCount = config.hasDebugViews() ? 3 : 1;
+    em.create(mCameraCount, mCameraEntities);
     mCameras[0] = mMainCamera = mFilamentApp->mEngine->createCamera(mCameraEntities[0]);
-    mCameras[1] = mDebugCamera = mFilamentApp->mEngine->createCamera(mCameraEntities[1]);
-    mCameras[2] = mOrthoCamera = mFilamentApp->mEngine->createCamera(mCameraEntities[2]);
+    if (config.hasDebugViews()) {
+        mCameras[1] = mDebugCamera = mFilamentApp->mEngine->createCamera(mCameraEntities[1]);
+        mCameras[2] = mOrthoCamera = mFilamentApp->mEngine->createCamera(mCameraEntities[2]);
+    }
 
     // set exposure
-    for (auto camera: mCameras) {
-        camera->setExposure(16.0f, 1 / 125.0f, 100.0f);
+    for (size_t i = 0; i < mCameraCount; i++) {
+        mCameras[i]->setExposure(16.0f, 1 / 125.0f, 100.0f);
     }
 
     // create views
@@ -391,9 +841,11 @@ FilamentAppWayland::Window::Window(FilamentAppWayland *filamentApp,
             .targetPosition(0, 0, -4)
             .flightMoveDamping(15.0)
             .build(config.cameraMode);
-    mDebugCameraMan = CameraManipulator::Builder()
-            .targetPosition(0, 0, -4)
-            .build(camutils::Mode::ORBIT);
+    if (config.hasDebugViews()) {
+        mDebugCameraMan = CameraManipulator::Builder()
+                .targetPosition(0, 0, -4)
+                .build(camutils::Mode::ORBIT);
+    }
 
     mMainView->setCamera(mMainCamera);
     mMainView->setCameraManipulator(mMainCameraMan);
@@ -421,13 +873,20 @@ FilamentAppWayland::Window::Window(FilamentAppWayland *filamentApp,
 FilamentAppWayland::Window::~Window() {
     mViews.clear();
     utils::EntityManager &em = utils::EntityManager::get();
-    for (auto e: mCameraEntities) {
-        mFilamentApp->mEngine->destroyCameraComponent(e);
-        em.destroy(e);
+    for (size_t i = 0; i < mCameraCount; i++) {
+        mFilamentApp->mEngine->destroyCameraComponent(mCameraEntities[i]);
+        em.destroy(mCameraEntities[i]);
     }
     mFilamentApp->mEngine->destroy(mRenderer);
     mFilamentApp->mEngine->destroy(mSwapChain);
 
+    // With a driver thread the swap chain is torn down asynchronously. Wait for it, the host
+    // destroys the native surface as soon as we return and the extent slot may be reused.
+    if (UTILS_HAS_THREADING) {
+        mFilamentApp->mEngine->flushAndWait();
+    }
+    releaseExtentSlot(mExtentSlot);
+
     delete mMainCameraMan;
     delete mDebugCameraMan;
 }
@@ -551,6 +1010,33 @@ void FilamentAppWayland::Window::resize() {
     }
 }
 
+filament::SwapChain *FilamentAppWayland::Window::createSwapChain() {
+    Engine *engine = mFilamentApp->mEngine;
+    if (mIsHeadless) {
+        // nothing is presented, frames leave through Renderer::readPixels()
+        return engine->createSwapChain((uint32_t) mWidth, (uint32_t) mHeight,
+                                       SwapChain::CONFIG_READABLE);
+    }
+    if (mExtentSlot < kExtentSlotCount) {
+        // Wayland surfaces have no extent of their own, the swap chain asks us for it
+        return engine->createSwapChain(mNativeWindow, sExtentCallbacks[mExtentSlot]);
+    }
+    return engine->createSwapChain(mNativeWindow);
+}
+
+void FilamentAppWayland::Window::setSize(size_t w, size_t h) {
+    mWidth = w;
+    mHeight = h;
+    setExtent(mExtentSlot, w, h);
+
+    // The extent is only queried when the swap chain is created, so it has to be rebuilt.
+    // Destruction is deferred by the engine until the GPU is done with it.
+    mFilamentApp->mEngine->destroy(mSwapChain);
+    mSwapChain = createSwapChain();
+
+    resize();
+}
+
 void FilamentAppWayland::Window::configureCamerasForWindow() {
     float dpiScaleX = 1.0f;
 
@@ -570,9 +1056,11 @@ void FilamentAppWayland::Window::configureCamerasForWindow() {
     double near = 0.1;
     double far = 100;
     mMainCamera->setLensProjection(mFilamentApp->mCameraFocalLength, double(mainWidth) / height, near, far);
-    mDebugCamera->setProjection(45.0, double(width) / height, 0.0625, 4096, Camera::Fov::VERTICAL);
-    mOrthoCamera->setProjection(Camera::Projection::ORTHO, -3, 3, -3 * ratio, 3 * ratio, near, far);
-    mOrthoCamera->lookAt({0, 0, 0}, {0, 0, -4});
+    if (mDebugCamera) {
+        mDebugCamera->setProjection(45.0, double(width) / height, 0.0625, 4096, Camera::Fov::VERTICAL);
+        mOrthoCamera->setProjection(Camera::Projection::ORTHO, -3, 3, -3 * ratio, 3 * ratio, near, far);
+        mOrthoCamera->lookAt({0, 0, 0}, {0, 0, -4});
+    }
 
     // We're in split view when there are more views than just the Main and UI views.
     if (splitview) {
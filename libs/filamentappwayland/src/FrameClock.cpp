@@ -0,0 +1,79 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/FrameClock.h>
+
+#include <algorithm>
+
+void FrameClock::tick(uint32_t timeMs) {
+    if (!mStarted) {
+        mStarted = true;
+        mLastTimeMs = timeMs;
+        mDelta = 0.0f;
+        mEarly = false;
+        return;
+    }
+
+    // unsigned subtraction handles the 32-bit wrap around
+    const uint32_t deltaMs = timeMs - mLastTimeMs;
+    mLastTimeMs = timeMs;
+
+    const double delta = deltaMs / 1000.0;
+    mNow += delta;
+    mDelta = float(delta);
+
+    if (!mHostRate && deltaMs > 0 && delta < MAX_SAMPLED_INTERVAL) {
+        addSample(delta);
+    }
+
+    // Anything under half a refresh can't have been a new vblank.
+    mEarly = isConverged() && delta < mRefreshInterval * 0.5;
+    if (mEarly) {
+        mEarlyFrames++;
+    }
+}
+
+void FrameClock::addSample(double interval) {
+    mHistory[mSamples % HISTORY_SIZE] = float(interval);
+    mSamples++;
+
+    // Mean of the middle half, the outliers at both ends are early ticks and missed vblanks.
+    const size_t count = std::min(mSamples, HISTORY_SIZE);
+    std::array<float, HISTORY_SIZE> sorted = mHistory;
+    std::sort(sorted.begin(), sorted.begin() + count);
+    const size_t first = count / 4;
+    const size_t last = count - count / 4;
+    double sum = 0.0;
+    for (size_t i = first; i < last; i++) {
+        sum += sorted[i];
+    }
+    mRefreshInterval = sum / double(last - first);
+}
+
+void FrameClock::setRefreshRate(float hz) {
+    mHostRate = hz > 0.0f;
+    if (mHostRate) {
+        mRefreshInterval = 1.0 / hz;
+    }
+}
+
+void FrameClock::reset() {
+    mStarted = false;
+    mEarly = false;
+    mNow = 0.0;
+    mDelta = 0.0f;
+    mEarlyFrames = 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/FramePacer.h>
+#include <filamentappwayland/FrameClock.h>
+
+#include <algorithm>
+#include <cmath>
+
+void FramePacer::setMaxFrameRate(float fps) {
+    mMaxFrameRate = std::max(fps, 0.0f);
+    mSinceLastFrame = HUGE_VAL;     // the next vblank renders
+    mChanged = true;
+}
+
+bool FramePacer::shouldRender(const FrameClock &clock) {
+    // the estimate moves a little every frame, only react to actual rate changes
+    const float refreshRate = std::round(2.0 / clock.refreshInterval()) * 0.5f;
+    uint32_t interval = 1;
+    if (mMaxFrameRate > 0.0f && mMaxFrameRate < refreshRate) {
+        interval = std::max(1u, uint32_t(std::lround(refreshRate / mMaxFrameRate)));
+    }
+    if (refreshRate != mRefreshRate || interval != mInterval) {
+        mRefreshRate = refreshRate;
+        mInterval = interval;
+        mChanged = true;
+    }
+
+    if (mMaxFrameRate <= 0.0f) {
+        return true;
+    }
+
+    mSinceLastFrame += clock.delta();
+
+    // Whatever the refresh estimate, a frame is due once the cap's own frame time has passed,
+    // give or take the millisecond resolution of the timestamps.
+    if (mSinceLastFrame >= 1.0 / mMaxFrameRate - 0.001) {
+        mSinceLastFrame = 0.0;
+        return true;
+    }
+
+    // FrameClock only reports early ticks once its refresh estimate has converged.
+    if (clock.isEarly()) {
+        mPacedFrames++;
+        return false;
+    }
+
+    // half a refresh of slack, the timestamps jitter around the vblank
+    if (!clock.isConverged() || mSinceLastFrame < (mInterval - 0.5) * clock.refreshInterval()) {
+        mPacedFrames++;
+        return false;
+    }
+    mSinceLastFrame = 0.0;
+    return true;
+}
+
+bool FramePacer::consumeChanged() {
+    const bool changed = mChanged;
+    mChanged = false;
+    return changed;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/FramePipeline.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <filament/Engine.h>
+#include <filament/Fence.h>
+
+#include <utils/compiler.h>
+
+using namespace filament;
+
+void FramePipeline::setEngine(Engine *engine) {
+    if (engine != mEngine) {
+        reset();
+        mEngine = engine;
+    }
+}
+
+void FramePipeline::configure(Mode mode, uint32_t framesInFlight) {
+    mMode = mode;
+    mLimit = framesInFlight ? std::min(framesInFlight, MAX_FRAMES_IN_FLIGHT) : 0;
+    if (!mLimit) {
+        reset();
+    }
+}
+
+bool FramePipeline::acquire(std::chrono::microseconds maxWait) {
+    if (!mLimit || !mEngine || mMode == Mode::HIGH_THROUGHPUT) {
+        return true;
+    }
+    return waitForSlot(maxWait);
+}
+
+bool FramePipeline::reserve(std::chrono::microseconds maxWait) {
+    if (!mLimit || !mEngine || mMode == Mode::LOW_LATENCY) {
+        return true;
+    }
+    return waitForSlot(maxWait);
+}
+
+void FramePipeline::submitted() {
+    if (!mLimit || !mEngine) {
+        return;
+    }
+    // a dropped frame never gets here, but a caller ignoring it mustn't overflow the ring
+    if (mCount == mFences.size()) {
+        retireOldest();
+    }
+    mFences[(mHead + mCount) % mFences.size()] = mEngine->createFence();
+    mCount++;
+}
+
+void FramePipeline::reset() {
+    while (mCount) {
+        retireOldest();
+    }
+    mHead = 0;
+}
+
+void FramePipeline::retireCompleted() {
+    while (mCount && mFences[mHead]->wait(Fence::Mode::DONT_FLUSH, 0) ==
+                     backend::FenceStatus::CONDITION_SATISFIED) {
+        retireOldest();
+    }
+}
+
+void FramePipeline::retireOldest() {
+    mEngine->destroy(mFences[mHead]);
+    mFences[mHead] = nullptr;
+    mHead = (mHead + 1) % mFences.size();
+    mCount--;
+}
+
+bool FramePipeline::waitForSlot(std::chrono::microseconds maxWait) {
+    retireCompleted();
+    if (mCount < mLimit) {
+        return true;
+    }
+
+    if (!UTILS_HAS_THREADING) {
+        // Fences only take a timeout with threads. Here nothing advances the command stream but
+        // this thread, so execute it and poll until the oldest frame completes or time runs out.
+        const auto deadline = std::chrono::steady_clock::now() + maxWait;
+        do {
+            mEngine->execute();
+            if (mFences[mHead]->wait(Fence::Mode::FLUSH, 0) == backend::FenceStatus::CONDITION_SATISFIED) {
+                retireOldest();
+                return true;
+            }
+            std::this_thread::yield();
+        } while (std::chrono::steady_clock::now() < deadline);
+        mThrottled++;
+        return false;
+    }
+
+    const uint64_t timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(maxWait).count();
+    if (mFences[mHead]->wait(Fence::Mode::FLUSH, timeout) == backend::FenceStatus::CONDITION_SATISFIED) {
+        retireOldest();
+        return true;
+    }
+    mThrottled++;
+    return false;
+}
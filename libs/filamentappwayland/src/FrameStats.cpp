@@ -0,0 +1,72 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/FrameStats.h>
+
+#include <algorithm>
+#include <cstring>
+
+void FrameStats::addFrameTime(float ms) {
+    mWorking.lastFrameMs = ms;
+    mHistory[mHistoryHead] = ms;
+    mHistoryHead = (mHistoryHead + 1) % HISTORY_SIZE;
+    mHistoryCount = std::min(mHistoryCount + 1, HISTORY_SIZE);
+    mHistoryChanged = true;
+}
+
+void FrameStats::publish() {
+    if (mHistoryChanged) {
+        mHistoryChanged = false;
+        std::array<float, HISTORY_SIZE> sorted{};
+        std::copy_n(mHistory.begin(), mHistoryCount, sorted.begin());
+        std::sort(sorted.begin(), sorted.begin() + mHistoryCount);
+        auto percentile = [&](size_t p) {
+            return sorted[(mHistoryCount - 1) * p / 100];
+        };
+        mWorking.p50FrameMs = percentile(50);
+        mWorking.p95FrameMs = percentile(95);
+        mWorking.p99FrameMs = percentile(99);
+    }
+
+    uint64_t words[WORD_COUNT] = {};
+    memcpy(words, &mWorking, sizeof(Snapshot));
+
+    // odd sequence while the words are being written
+    const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+        mWords[i].store(words[i], std::memory_order_relaxed);
+    }
+    mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+FrameStats::Snapshot FrameStats::read() const {
+    uint64_t words[WORD_COUNT];
+    uint32_t before, after;
+    do {
+        before = mSequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            words[i] = mWords[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = mSequence.load(std::memory_order_relaxed);
+    } while ((before & 1u) || before != after);
+
+    Snapshot snapshot;
+    memcpy(&snapshot, words, sizeof(Snapshot));
+    return snapshot;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/GpuTimer.h>
+
+#include <algorithm>
+
+#include <filament/Engine.h>
+#include <filament/Fence.h>
+
+#include <utils/compiler.h>
+
+using namespace filament;
+
+// how often the waiting thread checks for stop() while a fence is pending
+static constexpr uint64_t WAIT_SLICE_NS = 10000000;
+
+void GpuTimer::setEngine(Engine *engine) {
+    if (engine == mEngine) {
+        return;
+    }
+    stop();
+    mEngine = engine;
+    mFrameMs.store(0.0f, std::memory_order_relaxed);
+}
+
+void GpuTimer::submitted() {
+    if (!UTILS_HAS_THREADING || !mEngine) {
+        return;
+    }
+    retire();
+
+    std::unique_lock<std::mutex> lock(mLock);
+    if (mSubmitted - mRetired == MAX_PENDING) {
+        return;     // the backend is far behind, this frame goes untimed
+    }
+    mFrames[mSubmitted % MAX_PENDING] = { mEngine->createFence(), std::chrono::steady_clock::now() };
+    mSubmitted++;
+    if (!mThread.joinable()) {
+        mStop = false;
+        mThread = std::thread(&GpuTimer::run, this);
+    }
+    lock.unlock();
+    mCondition.notify_one();
+}
+
+void GpuTimer::run() {
+    std::chrono::steady_clock::time_point previous{};
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [this]() { return mStop || mCompleted < mSubmitted; });
+        if (mStop) {
+            return;
+        }
+        const Frame frame = mFrames[mCompleted % MAX_PENDING];
+        lock.unlock();
+
+        bool signaled = false;
+        while (!signaled) {
+            signaled = frame.fence->wait(Fence::Mode::DONT_FLUSH, WAIT_SLICE_NS) ==
+                       backend::FenceStatus::CONDITION_SATISFIED;
+            if (!signaled) {
+                std::lock_guard<std::mutex> guard(mLock);
+                if (mStop) {
+                    return;
+                }
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const std::chrono::duration<float, std::milli> busy = now - std::max(frame.submitted, previous);
+        previous = now;
+        mFrameMs.store(busy.count(), std::memory_order_relaxed);
+
+        lock.lock();
+        mCompleted++;
+    }
+}
+
+void GpuTimer::stop() {
+    if (mThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mStop = true;
+        }
+        mCondition.notify_one();
+        mThread.join();
+    }
+    // nothing waits on the fences anymore
+    for (uint64_t i = mRetired; i < mSubmitted; i++) {
+        mEngine->destroy(mFrames[i % MAX_PENDING].fence);
+    }
+    mFrames = {};
+    mSubmitted = mCompleted = mRetired = 0;
+}
+
+void GpuTimer::retire() {
+    std::lock_guard<std::mutex> lock(mLock);
+    while (mRetired < mCompleted) {
+        mEngine->destroy(mFrames[mRetired % MAX_PENDING].fence);
+        mRetired++;
+    }
+}
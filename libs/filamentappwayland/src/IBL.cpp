@@ -15,6 +15,8 @@
  */
 
 #include <filamentappwayland/IBL.h>
+#include <filamentappwayland/ResourceStats.h>
+#include <filamentappwayland/TraceRecorder.h>
 
 #include <filament/Engine.h>
 #include <filament/IndirectLight.h>
@@ -48,6 +50,7 @@ IBL::IBL(Engine &engine) : mEngine(engine) {
 }
 
 IBL::~IBL() {
+    ResourceStats::track(ResourceStats::Kind::TEXTURE, 0, -mTextureBytes);
     mEngine.destroy(mIndirectLight);
     mEngine.destroy(mTexture);
     mEngine.destroy(mSkybox);
@@ -90,6 +93,7 @@ bool IBL::loadFromEquirect(Path const &path) {
 
     equirect->setImage(mEngine, 0, std::move(buffer));
 
+    TraceRecorder::Scope trace("ibl prefilter", "ibl");
     IBLPrefilterContext context(mEngine);
     IBLPrefilterContext::EquirectangularToCubemap equirectangularToCubemap(context);
     IBLPrefilterContext::SpecularFilter specularFilter(context);
@@ -110,17 +114,24 @@ bool IBL::loadFromEquirect(Path const &path) {
             .showSun(true)
             .build(mEngine);
 
+    trackTextures();
     return true;
 }
 
-bool IBL::loadFromKtx(const std::string &prefix) {
+IBL::KtxPayload::~KtxPayload() {
+    delete ibl;
+    delete skybox;
+}
+
+std::unique_ptr<IBL::KtxPayload> IBL::readKtx(const std::string &prefix) {
+    TraceRecorder::Scope trace("ibl read ktx", "ibl");
     Path iblPath(prefix + "_ibl.ktx");
     if (!iblPath.exists()) {
-        return false;
+        return nullptr;
     }
     Path skyPath(prefix + "_skybox.ktx");
     if (!skyPath.exists()) {
-        return false;
+        return nullptr;
     }
 
     auto createKtx = [](Path path) {
@@ -130,16 +141,35 @@ bool IBL::loadFromKtx(const std::string &prefix) {
         return new image::Ktx1Bundle(contents.data(), contents.size());
     };
 
-    Ktx1Bundle *iblKtx = createKtx(iblPath);
-    Ktx1Bundle *skyKtx = createKtx(skyPath);
+    auto payload = std::make_unique<KtxPayload>();
+    payload->ibl = createKtx(iblPath);
+    payload->skybox = createKtx(skyPath);
+    return payload;
+}
+
+std::unique_ptr<IBL::KtxPayload> IBL::prefetchFromDirectory(const utils::Path &path) {
+    if (!path.isDirectory()) {
+        return nullptr;
+    }
+    return readKtx(Path::concat(path, path.getName()));
+}
 
-    mSkyboxTexture = Ktx1Reader::createTexture(&mEngine, skyKtx, false);
-    mTexture = Ktx1Reader::createTexture(&mEngine, iblKtx, false);
+bool IBL::loadFromKtx(const std::string &prefix) {
+    std::unique_ptr<KtxPayload> payload = readKtx(prefix);
+    return payload && loadFromPayload(*payload);
+}
 
-    if (!iblKtx->getSphericalHarmonics(mBands)) {
+bool IBL::loadFromPayload(KtxPayload &payload) {
+    if (!payload.ibl || !payload.skybox || !payload.ibl->getSphericalHarmonics(mBands)) {
         return false;
     }
 
+    // createTexture() takes ownership of the bundles
+    mSkyboxTexture = Ktx1Reader::createTexture(&mEngine, payload.skybox, false);
+    mTexture = Ktx1Reader::createTexture(&mEngine, payload.ibl, false);
+    payload.skybox = nullptr;
+    payload.ibl = nullptr;
+
     mIndirectLight = IndirectLight::Builder()
             .reflections(mTexture)
             .intensity(IBL_INTENSITY)
@@ -147,6 +177,7 @@ bool IBL::loadFromKtx(const std::string &prefix) {
 
     mSkybox = Skybox::Builder().environment(mSkyboxTexture).showSun(true).build(mEngine);
 
+    trackTextures();
     return true;
 }
 
@@ -191,9 +222,17 @@ bool IBL::loadFromDirectory(const utils::Path &path) {
 
     mSkybox = Skybox::Builder().environment(mSkyboxTexture).showSun(true).build(mEngine);
 
+    trackTextures();
     return true;
 }
 
+void IBL::trackTextures() {
+    const int64_t bytes = ResourceStats::estimateTextureBytes(mTexture) +
+                          ResourceStats::estimateTextureBytes(mSkyboxTexture);
+    ResourceStats::track(ResourceStats::Kind::TEXTURE, 0, bytes - mTextureBytes);
+    mTextureBytes = bytes;
+}
+
 bool IBL::loadCubemapLevel(filament::Texture **texture, const utils::Path &path, size_t level,
                            std::string const &levelPrefix) const {
     uint32_t dim;
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/MaterialCache.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+namespace {
+    constexpr uint32_t kMagic = 0x50434D46;  // "FMCP"
+    constexpr uint32_t kFormatVersion = 1;
+    constexpr const char *kExtension = ".filamat";
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    uint64_t checksum(const void *data, size_t size) {
+        // FNV-1a
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto const *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    int64_t toNs(const timespec &time) {
+        return int64_t(time.tv_sec) * 1000000000ll + time.tv_nsec;
+    }
+
+    int64_t now() {
+        timespec time{};
+        clock_gettime(CLOCK_REALTIME, &time);
+        return toNs(time);
+    }
+
+    bool endsWith(const std::string &str, const std::string &suffix) {
+        return str.size() >= suffix.size() &&
+               str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}  // namespace
+
+MaterialCache::MaterialCache(std::string directory, std::string tag, size_t maxBytes)
+        : mDirectory(std::move(directory)), mTag(std::move(tag)), mMaxBytes(maxBytes) {
+    DIR *dir = opendir(mDirectory.c_str());
+    if (!dir) {
+        std::cerr << "Unable to open material cache: " << mDirectory << std::endl;
+        return;
+    }
+
+    while (dirent *item = readdir(dir)) {
+        const std::string name = item->d_name;
+        const std::string path = mDirectory + "/" + name;
+        if (endsWith(name, ".tmp")) {
+            // left behind by a store() that didn't finish
+            unlink(path.c_str());
+            continue;
+        }
+        struct stat info{};
+        if (!endsWith(name, kExtension) || stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            continue;
+        }
+        mEntries[name] = { size_t(info.st_size), toNs(info.st_mtim) };
+        mTotalBytes += size_t(info.st_size);
+    }
+    closedir(dir);
+
+    // the limit may have been lowered since the last run
+    evict(0);
+}
+
+std::string MaterialCache::getFileName(uint64_t key) const {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016" PRIx64, key);
+    return std::string(hex) + "-" + mTag + kExtension;
+}
+
+bool MaterialCache::load(uint64_t key, std::vector<uint8_t> &out) {
+    std::lock_guard<std::mutex> lock(mLock);
+    const std::string name = getFileName(key);
+    auto pos = mEntries.find(name);
+    if (pos == mEntries.end()) {
+        return false;
+    }
+
+    const std::string path = mDirectory + "/" + name;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        remove(name);
+        return false;
+    }
+    Header header{};
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == kMagic && header.version == kFormatVersion &&
+                 header.size + sizeof(header) == pos->second.size;
+    if (valid) {
+        out.resize(size_t(header.size));
+        valid = fread(out.data(), 1, out.size(), file) == out.size() &&
+                checksum(out.data(), out.size()) == header.checksum;
+    }
+    fclose(file);
+
+    if (!valid) {
+        std::cerr << "Discarding corrupt material cache entry: " << path << std::endl;
+        out.clear();
+        remove(name);
+        return false;
+    }
+
+    // the modification time doubles as the last use, so the LRU order survives restarts
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    pos->second.lastUse = now();
+    return true;
+}
+
+void MaterialCache::store(uint64_t key, const void *data, size_t size) {
+    const size_t total = size + sizeof(Header);
+    if (total > mMaxBytes) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    const std::string name = getFileName(key);
+    if (mEntries.find(name) != mEntries.end()) {
+        remove(name);
+    }
+    evict(total);
+
+    const std::string path = mDirectory + "/" + name;
+    const std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Unable to write material cache entry: " << temporary << std::endl;
+        return;
+    }
+    const Header header = { kMagic, kFormatVersion, uint64_t(size), checksum(data, size) };
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(data, 1, size, file) == size;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Unable to write material cache entry: " << path << std::endl;
+        unlink(temporary.c_str());
+        return;
+    }
+
+    mEntries[name] = { total, now() };
+    mTotalBytes += total;
+}
+
+size_t MaterialCache::getSize() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mTotalBytes;
+}
+
+void MaterialCache::remove(const std::string &name) {
+    auto pos = mEntries.find(name);
+    if (pos == mEntries.end()) {
+        return;
+    }
+    unlink((mDirectory + "/" + name).c_str());
+    mTotalBytes -= pos->second.size;
+    mEntries.erase(pos);
+}
+
+void MaterialCache::evict(size_t size) {
+    const std::string suffix = "-" + mTag + kExtension;
+    while (!mEntries.empty() && mTotalBytes + size > mMaxBytes) {
+        // entries of another backend, feature level or version go first, then the oldest
+        auto victim = mEntries.begin();
+        bool victimStale = !endsWith(victim->first, suffix);
+        for (auto it = std::next(mEntries.begin()); it != mEntries.end(); ++it) {
+            const bool stale = !endsWith(it->first, suffix);
+            if (stale > victimStale ||
+                (stale == victimStale && it->second.lastUse < victim->second.lastUse)) {
+                victim = it;
+                victimStale = stale;
+            }
+        }
+        remove(victim->first);
+    }
+}
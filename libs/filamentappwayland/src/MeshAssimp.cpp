@@ -26,6 +26,8 @@
 #define GL_TEXTURE_WRAP_T                 0x2803
 
 #include <filamentappwayland/MeshAssimp.h>
+#include <filamentappwayland/ResourceStats.h>
+#include <filamentappwayland/TraceRecorder.h>
 
 #include <stdlib.h>
 #include <string.h>
@@ -59,8 +61,27 @@
 
 #include "generated/resources/filamentappwl.h"
 
-using namespace filament;
+#ifndef FILAMENTAPP_PRECOMPILED_GLTF_MATERIALS
+#define FILAMENTAPP_PRECOMPILED_GLTF_MATERIALS 0
+#endif
+
+#ifndef FILAMENTAPP_RUNTIME_MATERIALS
+#define FILAMENTAPP_RUNTIME_MATERIALS 1
+#endif
+
+#if FILAMENTAPP_PRECOMPILED_GLTF_MATERIALS
+#include "generated/resources/gltfmaterials.h"
+#endif
+
+#if FILAMENTAPP_RUNTIME_MATERIALS
+#include <filamat/MaterialBuilder.h>
+
+#include <utils/JobSystem.h>
+
 using namespace filamat;
+#endif
+
+using namespace filament;
 using namespace filament::math;
 using namespace utils;
 
@@ -74,19 +95,42 @@ struct MaterialConfig {
     bool doubleSided = false;
     bool unlit = false;
     bool hasVertexColors = false;
+    // MASKED materials get their alpha cutoff per instance, see MaterialInstance::setMaskThreshold()
     AlphaMode alphaMode = AlphaMode::OPAQUE;
-    float maskThreshold = 0.5f;
     uint8_t baseColorUV = 0;
     uint8_t metallicRoughnessUV = 0;
     uint8_t emissiveUV = 0;
     uint8_t aoUV = 0;
     uint8_t normalUV = 0;
+    // maps the material samples, the UV index of a missing map is 0
+    bool hasBaseColorMap = false;
+    bool hasMetallicRoughnessMap = false;
+    bool hasEmissiveMap = false;
+    bool hasAOMap = false;
+    bool hasNormalMap = false;
 
     uint8_t maxUVIndex() {
         return std::max({baseColorUV, metallicRoughnessUV, emissiveUV, aoUV, normalUV});
     }
 };
 
+// Clears whatever the material doesn't sample, so configs that compile to the same material
+// also hash the same: unlit materials only use the base color map, and the UV index of a
+// missing map doesn't matter.
+void dropUnusedMaps(MaterialConfig &config) {
+    if (config.unlit) {
+        config.hasMetallicRoughnessMap = false;
+        config.hasEmissiveMap = false;
+        config.hasAOMap = false;
+        config.hasNormalMap = false;
+    }
+    config.baseColorUV = config.hasBaseColorMap ? config.baseColorUV : 0;
+    config.metallicRoughnessUV = config.hasMetallicRoughnessMap ? config.metallicRoughnessUV : 0;
+    config.emissiveUV = config.hasEmissiveMap ? config.emissiveUV : 0;
+    config.aoUV = config.hasAOMap ? config.aoUV : 0;
+    config.normalUV = config.hasNormalMap ? config.normalUV : 0;
+}
+
 void appendBooleanToBitMask(uint64_t &bitmask, bool b) {
     bitmask <<= 1;
     bitmask |= b;
@@ -94,7 +138,6 @@ void appendBooleanToBitMask(uint64_t &bitmask, bool b) {
 
 uint64_t hashMaterialConfig(MaterialConfig config) {
     uint64_t bitmask = 0;
-    memcpy(&bitmask, &config.maskThreshold, sizeof(config.maskThreshold));
     appendBooleanToBitMask(bitmask, config.doubleSided);
     appendBooleanToBitMask(bitmask, config.unlit);
     appendBooleanToBitMask(bitmask, config.hasVertexColors);
@@ -106,21 +149,38 @@ uint64_t hashMaterialConfig(MaterialConfig config) {
     appendBooleanToBitMask(bitmask, config.emissiveUV == 0);
     appendBooleanToBitMask(bitmask, config.aoUV == 0);
     appendBooleanToBitMask(bitmask, config.normalUV == 0);
+    appendBooleanToBitMask(bitmask, config.hasBaseColorMap);
+    appendBooleanToBitMask(bitmask, config.hasMetallicRoughnessMap);
+    appendBooleanToBitMask(bitmask, config.hasEmissiveMap);
+    appendBooleanToBitMask(bitmask, config.hasAOMap);
+    appendBooleanToBitMask(bitmask, config.hasNormalMap);
     return bitmask;
 }
 
+// cmake/gltf_materials.cmake generates the same material for the precompiled variants, keep the
+// two in sync.
 std::string shaderFromConfig(MaterialConfig config) {
     std::string shader = R"SHADER(
         void material(inout MaterialInputs material) {
     )SHADER";
 
-    shader += "float2 normalUV = getUV" + std::to_string(config.normalUV) + "();\n";
-    shader += "float2 baseColorUV = getUV" + std::to_string(config.baseColorUV) + "();\n";
-    shader += "float2 metallicRoughnessUV = getUV" + std::to_string(config.metallicRoughnessUV) + "();\n";
-    shader += "float2 aoUV = getUV" + std::to_string(config.aoUV) + "();\n";
-    shader += "float2 emissiveUV = getUV" + std::to_string(config.emissiveUV) + "();\n";
+    if (config.hasNormalMap) {
+        shader += "float2 normalUV = getUV" + std::to_string(config.normalUV) + "();\n";
+    }
+    if (config.hasBaseColorMap) {
+        shader += "float2 baseColorUV = getUV" + std::to_string(config.baseColorUV) + "();\n";
+    }
+    if (config.hasMetallicRoughnessMap) {
+        shader += "float2 metallicRoughnessUV = getUV" + std::to_string(config.metallicRoughnessUV) + "();\n";
+    }
+    if (config.hasAOMap) {
+        shader += "float2 aoUV = getUV" + std::to_string(config.aoUV) + "();\n";
+    }
+    if (config.hasEmissiveMap) {
+        shader += "float2 emissiveUV = getUV" + std::to_string(config.emissiveUV) + "();\n";
+    }
 
-    if (!config.unlit) {
+    if (!config.unlit && config.hasNormalMap) {
         shader += R"SHADER(
             material.normal = texture(materialParams_normalMap, normalUV).xyz * 2.0 - 1.0;
             material.normal.y = -material.normal.y;
@@ -129,10 +189,15 @@ std::string shaderFromConfig(MaterialConfig config) {
 
     shader += R"SHADER(
         prepareMaterial(material);
-        material.baseColor = texture(materialParams_baseColorMap, baseColorUV);
-        material.baseColor *= materialParams.baseColorFactor;
+        material.baseColor = materialParams.baseColorFactor;
     )SHADER";
 
+    if (config.hasBaseColorMap) {
+        shader += R"SHADER(
+            material.baseColor *= texture(materialParams_baseColorMap, baseColorUV);
+        )SHADER";
+    }
+
     if (config.alphaMode == AlphaMode::TRANSPARENT) {
         shader += R"SHADER(
             material.baseColor.rgb *= material.baseColor.a;
@@ -141,41 +206,116 @@ std::string shaderFromConfig(MaterialConfig config) {
 
     if (!config.unlit) {
         shader += R"SHADER(
-            vec4 metallicRoughness = texture(materialParams_metallicRoughnessMap, metallicRoughnessUV);
-            material.roughness = materialParams.roughnessFactor * metallicRoughness.g;
-            material.metallic = materialParams.metallicFactor * metallicRoughness.b;
-            material.ambientOcclusion = texture(materialParams_aoMap, aoUV).r;
-            material.emissive.rgb = texture(materialParams_emissiveMap, emissiveUV).rgb;
-            material.emissive.rgb *= materialParams.emissiveFactor.rgb;
+            material.roughness = materialParams.roughnessFactor;
+            material.metallic = materialParams.metallicFactor;
+            material.emissive.rgb = materialParams.emissiveFactor.rgb;
             material.emissive.a = 0.0;
         )SHADER";
+        if (config.hasMetallicRoughnessMap) {
+            shader += R"SHADER(
+                vec4 metallicRoughness = texture(materialParams_metallicRoughnessMap, metallicRoughnessUV);
+                material.roughness *= metallicRoughness.g;
+                material.metallic *= metallicRoughness.b;
+            )SHADER";
+        }
+        if (config.hasAOMap) {
+            shader += R"SHADER(
+                material.ambientOcclusion = texture(materialParams_aoMap, aoUV).r;
+            )SHADER";
+        }
+        if (config.hasEmissiveMap) {
+            shader += R"SHADER(
+                material.emissive.rgb *= texture(materialParams_emissiveMap, emissiveUV).rgb;
+            )SHADER";
+        }
     }
 
     shader += "}\n";
     return shader;
 }
 
-Material *createMaterialFromConfig(Engine &engine, MaterialConfig config) {
+#if FILAMENTAPP_PRECOMPILED_GLTF_MATERIALS
+
+constexpr uint32_t kNoVariant = UINT32_MAX;
+
+// Index of the variant built by cmake/gltf_materials.cmake for config, keep the two in sync.
+// Returns kNoVariant for configs the build never precompiles.
+uint32_t gltfVariantIndex(MaterialConfig config) {
+    if (config.maxUVIndex() > 1) {
+        return kNoVariant;
+    }
+    const uint32_t uvMask = config.normalUV << 0u | config.baseColorUV << 1u |
+                            config.metallicRoughnessUV << 2u | config.aoUV << 3u |
+                            config.emissiveUV << 4u;
+    const uint32_t mapMask = uint32_t(config.hasNormalMap) << 0u |
+                             uint32_t(config.hasBaseColorMap) << 1u |
+                             uint32_t(config.hasMetallicRoughnessMap) << 2u |
+                             uint32_t(config.hasAOMap) << 3u |
+                             uint32_t(config.hasEmissiveMap) << 4u;
+    return uvMask | uint32_t(config.doubleSided) << 5u | uint32_t(config.unlit) << 6u |
+           uint32_t(config.alphaMode) << 7u | mapMask << 9u;
+}
+
+struct PrecompiledMaterial {
+    uint32_t index;
+    const uint8_t *data;
+    size_t size;
+};
+
+const PrecompiledMaterial *findPrecompiledMaterial(MaterialConfig config) {
+    static const PrecompiledMaterial kMaterials[] = {
+#include "generated/resources/gltfmaterials_table.inc"
+    };
+    const uint32_t index = gltfVariantIndex(config);
+    for (auto const &material : kMaterials) {
+        if (material.index == index) {
+            return &material;
+        }
+    }
+    return nullptr;
+}
+
+#endif
+
+#if FILAMENTAPP_RUNTIME_MATERIALS
+
+// Bump whenever shaderFromConfig() or compileMaterial() change the generated package.
+constexpr uint64_t kMaterialGeneratorVersion = 3;
+
+// MaterialBuilder::init() must have been called.
+Package compileMaterial(MaterialConfig config) {
+    TraceRecorder::Scope trace("material build", "material");
     std::string shader = shaderFromConfig(config);
-    MaterialBuilder::init();
     MaterialBuilder builder;
     builder
             .name("material")
             .material(shader.c_str())
             .doubleSided(config.doubleSided)
             .require(VertexAttribute::UV0)
-            .parameter("baseColorMap", MaterialBuilder::SamplerType::SAMPLER_2D)
             .parameter("baseColorFactor", MaterialBuilder::UniformType::FLOAT4)
-            .parameter("metallicRoughnessMap", MaterialBuilder::SamplerType::SAMPLER_2D)
-            .parameter("aoMap", MaterialBuilder::SamplerType::SAMPLER_2D)
-            .parameter("emissiveMap", MaterialBuilder::SamplerType::SAMPLER_2D)
-            .parameter("normalMap", MaterialBuilder::SamplerType::SAMPLER_2D)
             .parameter("metallicFactor", MaterialBuilder::UniformType::FLOAT)
             .parameter("roughnessFactor", MaterialBuilder::UniformType::FLOAT)
             .parameter("normalScale", MaterialBuilder::UniformType::FLOAT)
             .parameter("aoStrength", MaterialBuilder::UniformType::FLOAT)
             .parameter("emissiveFactor", MaterialBuilder::UniformType::FLOAT3);
 
+    // missing maps don't get a sampler at all
+    if (config.hasBaseColorMap) {
+        builder.parameter("baseColorMap", MaterialBuilder::SamplerType::SAMPLER_2D);
+    }
+    if (config.hasMetallicRoughnessMap) {
+        builder.parameter("metallicRoughnessMap", MaterialBuilder::SamplerType::SAMPLER_2D);
+    }
+    if (config.hasAOMap) {
+        builder.parameter("aoMap", MaterialBuilder::SamplerType::SAMPLER_2D);
+    }
+    if (config.hasEmissiveMap) {
+        builder.parameter("emissiveMap", MaterialBuilder::SamplerType::SAMPLER_2D);
+    }
+    if (config.hasNormalMap) {
+        builder.parameter("normalMap", MaterialBuilder::SamplerType::SAMPLER_2D);
+    }
+
     if (config.maxUVIndex() > 0) {
         builder.require(VertexAttribute::UV1);
     }
@@ -183,7 +323,6 @@ Material *createMaterialFromConfig(Engine &engine, MaterialConfig config) {
     switch (config.alphaMode) {
         case AlphaMode::MASKED :
             builder.blending(MaterialBuilder::BlendingMode::MASKED);
-            builder.maskThreshold(config.maskThreshold);
             break;
         case AlphaMode::TRANSPARENT :
             builder.blending(MaterialBuilder::BlendingMode::TRANSPARENT);
@@ -194,8 +333,59 @@ Material *createMaterialFromConfig(Engine &engine, MaterialConfig config) {
 
     builder.shading(config.unlit ? Shading::UNLIT : Shading::LIT);
 
-    Package pkg = builder.build(engine.getJobSystem());
-    return Material::Builder().package(pkg.getData(), pkg.getSize()).build(engine);
+    // filamat needs a JobSystem this thread belongs to, the engine's only takes the engine thread
+    JobSystem jobSystem(1);
+    jobSystem.adopt();
+    Package package = builder.build(jobSystem);
+    jobSystem.emancipate();
+    return package;
+}
+
+// Worker thread. Returns the package for config from the cache, or compiles and caches it.
+// Empty if compilation failed.
+std::vector<uint8_t> buildMaterialPackage(MaterialCache *cache, MaterialConfig config) {
+    // the config hash leaves the top bits clear
+    const uint64_t key = hashMaterialConfig(config) ^ (kMaterialGeneratorVersion << 56);
+
+    std::vector<uint8_t> package;
+    if (cache && cache->load(key, package)) {
+        return package;
+    }
+
+    Package pkg = compileMaterial(config);
+    if (!pkg.isValid()) {
+        return {};
+    }
+    if (cache) {
+        cache->store(key, pkg.getData(), pkg.getSize());
+    }
+    auto const *data = static_cast<const uint8_t *>(pkg.getData());
+    return { data, data + pkg.getSize() };
+}
+
+#endif
+
+// Returns the precompiled variant for config, nullptr if it has to be built at runtime.
+Material *loadPrecompiledMaterial(Engine &engine, MaterialConfig config, size_t *outPackageSize) {
+#if FILAMENTAPP_PRECOMPILED_GLTF_MATERIALS
+    const PrecompiledMaterial *precompiled = findPrecompiledMaterial(config);
+#if !FILAMENTAPP_RUNTIME_MATERIALS
+    if (!precompiled) {
+        // UV0 variants are always built
+        std::cerr << "glTF material configuration wasn't precompiled, falling back to UV0" << std::endl;
+        MaterialConfig fallback = config;
+        fallback.baseColorUV = fallback.metallicRoughnessUV = fallback.emissiveUV = 0;
+        fallback.aoUV = fallback.normalUV = 0;
+        precompiled = findPrecompiledMaterial(fallback);
+    }
+#endif
+    if (precompiled) {
+        TraceRecorder::Scope trace("material load", "material");
+        *outPackageSize = precompiled->size;
+        return Material::Builder().package(precompiled->data, precompiled->size).build(engine);
+    }
+#endif
+    return nullptr;
 }
 
 Texture *MeshAssimp::createOneByOneTexture(uint32_t pixel) {
@@ -257,7 +447,8 @@ static ushort2 convertUV(float2 uv) {
     }
 }
 
-MeshAssimp::MeshAssimp(Engine &engine) : mEngine(engine) {
+MeshAssimp::MeshAssimp(Engine &engine, MaterialCache *materialCache)
+        : mEngine(engine), mMaterialCache(materialCache) {
     mDefaultMap = createOneByOneTexture(0xffffffff);
     mDefaultNormalMap = createOneByOneTexture(0xffff8080);
 
@@ -277,9 +468,24 @@ MeshAssimp::MeshAssimp(Engine &engine) : mEngine(engine) {
     mDefaultTransparentColorMaterial->setDefaultParameter("baseColor", RgbType::LINEAR, float3{0.8});
     mDefaultTransparentColorMaterial->setDefaultParameter("metallic", 0.0f);
     mDefaultTransparentColorMaterial->setDefaultParameter("roughness", 0.4f);
+
+    mMaterialBytes = FILAMENTAPPWL_AIDEFAULTMAT_SIZE + FILAMENTAPPWL_AIDEFAULTTRANS_SIZE;
+    ResourceStats::track(ResourceStats::Kind::MATERIAL, mMaterialBytes, 0);
+    ResourceStats::track(ResourceStats::Kind::TEXTURE, 0,
+                         ResourceStats::estimateTextureBytes(mDefaultMap) +
+                         ResourceStats::estimateTextureBytes(mDefaultNormalMap));
 }
 
 MeshAssimp::~MeshAssimp() {
+    int64_t textureBytes = ResourceStats::estimateTextureBytes(mDefaultMap) +
+                           ResourceStats::estimateTextureBytes(mDefaultNormalMap);
+    for (Texture *texture: mTextures) {
+        textureBytes += ResourceStats::estimateTextureBytes(texture);
+    }
+    ResourceStats::track(ResourceStats::Kind::TEXTURE, 0, -textureBytes);
+    ResourceStats::track(ResourceStats::Kind::MATERIAL, -mMaterialBytes, 0);
+    ResourceStats::track(ResourceStats::Kind::MESH, 0, -mMeshBytes);
+
     mEngine.destroy(mVertexBuffer);
     mEngine.destroy(mIndexBuffer);
     mEngine.destroy(mDefaultColorMaterial);
@@ -304,6 +510,74 @@ MeshAssimp::~MeshAssimp() {
     EntityManager::get().destroy(mRenderables.size(), mRenderables.data());
 }
 
+bool MeshAssimp::updateMaterials(bool *swapped) {
+    if (swapped) {
+        *swapped = false;
+    }
+    for (auto build = mMaterialBuilds.begin(); build != mMaterialBuilds.end();) {
+        if (build->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++build;
+            continue;
+        }
+        std::vector<uint8_t> package = build->second.get();
+        Material *material = nullptr;
+        if (!package.empty()) {
+            TraceRecorder::Scope trace("material load", "material");
+            material = Material::Builder().package(package.data(), package.size()).build(mEngine);
+        }
+        if (material) {
+            mGltfMaterialCache[build->first] = material;
+            mMaterialBytes += int64_t(package.size());
+            ResourceStats::track(ResourceStats::Kind::MATERIAL, int64_t(package.size()), 0);
+        } else {
+            std::cerr << "Unable to build glTF material, keeping the default material" << std::endl;
+        }
+        build = mMaterialBuilds.erase(build);
+    }
+
+    RenderableManager &rm = mEngine.getRenderableManager();
+    for (auto pending = mPendingMaterials.begin(); pending != mPendingMaterials.end();) {
+        auto built = mGltfMaterialCache.find(pending->configHash);
+        if (built == mGltfMaterialCache.end()) {
+            if (mMaterialBuilds.find(pending->configHash) == mMaterialBuilds.end()) {
+                // the build failed, the placeholder stays
+                pending = mPendingMaterials.erase(pending);
+            } else {
+                ++pending;
+            }
+            continue;
+        }
+
+        MaterialInstance *instance;
+        {
+            TraceRecorder::Scope trace("material instance", "material");
+            instance = built->second->createInstance();
+        }
+        for (auto const &set: pending->setup) {
+            set(instance);
+        }
+        for (Entity entity: mRenderables) {
+            auto ri = rm.getInstance(entity);
+            if (!ri) {
+                continue;
+            }
+            for (size_t i = 0, count = rm.getPrimitiveCount(ri); i < count; i++) {
+                if (rm.getMaterialInstanceAt(ri, i) == pending->placeholder) {
+                    rm.setMaterialInstanceAt(ri, i, instance);
+                }
+            }
+        }
+        (*pending->materials)[pending->name] = instance;
+        mEngine.destroy(pending->placeholder);
+        pending = mPendingMaterials.erase(pending);
+        if (swapped) {
+            *swapped = true;
+        }
+    }
+
+    return !mMaterialBuilds.empty();
+}
+
 template<typename T>
 struct State {
     std::vector<T> state;
@@ -339,6 +613,7 @@ static void loadTexture(Engine *engine, const std::string &filePath, Texture **m
 
             Texture::Format outputFormat = hasAlpha ? Texture::Format::RGBA : Texture::Format::RGB;
 
+            TraceRecorder::Scope trace("texture decode", "import");
             uint8_t *data = stbi_load(path.getAbsolutePath().c_str(), &w, &h, &n, numChannels);
             if (data != nullptr) {
                 *map = Texture::Builder()
@@ -380,6 +655,7 @@ void loadEmbeddedTexture(Engine *engine, aiTexture *embeddedTexture, Texture **m
 
     Texture::Format outputFormat = hasAlpha ? Texture::Format::RGBA : Texture::Format::RGB;
 
+    TraceRecorder::Scope trace("texture decode", "import");
     uint8_t *data = stbi_load_from_memory((unsigned char *) embeddedTexture->pcData,
                                           embeddedTexture->mWidth, &w, &h, &n, numChannels);
 
@@ -454,13 +730,22 @@ TextureSampler::MagFilter aiMagFilterToFilament(unsigned int aiMagFilter) {
     }
 }
 
+using MaterialSetup = std::vector<std::function<void(MaterialInstance *)>>;
+
+// Records instance->setParameter(name, args...) to be applied once the instance exists.
+template<typename... ARGS>
+void recordParameter(MaterialSetup &setup, const char *name, ARGS... args) {
+    setup.emplace_back([=](MaterialInstance *instance) {
+        instance->setParameter(name, args...);
+    });
+}
+
 // TODO: Change this to a member function (requires some alteration of cmakelsts.txt)
 void setTextureFromPath(const aiScene *scene, Engine *engine,
-                        std::vector<filament::Texture *> textures, const aiString &textureFile,
-                        const std::string &materialName, const std::string &textureDirectory,
-                        aiTextureMapMode *mapMode, const char *parameterName,
-                        std::map<std::string, MaterialInstance *> &outMaterials,
-                        unsigned int aiMinFilterType = 0, unsigned int aiMagFilterType = 0) {
+                        std::vector<filament::Texture *> &textures, const aiString &textureFile,
+                        const std::string &textureDirectory,
+                        aiTextureMapMode *mapMode, const char *parameterName, MaterialSetup &setup,
+                        Texture *fallback, unsigned int aiMinFilterType = 0, unsigned int aiMagFilterType = 0) {
 
     TextureSampler::MinFilter minFilterType = aiMinFilterToFilament(aiMinFilterType);
     TextureSampler::MagFilter magFilterType = aiMagFilterToFilament(aiMagFilterType);
@@ -493,11 +778,13 @@ void setTextureFromPath(const aiScene *scene, Engine *engine,
         loadTexture(engine, textureDirectory + textureFile.C_Str(), &textureMap, isSRGB, hasAlpha);
     }
 
-    textures.push_back(textureMap);
-
-    if (textureMap != nullptr) {
-        outMaterials[materialName]->setParameter(parameterName, textureMap, sampler);
+    // owned, counted and destroyed by the MeshAssimp through textures
+    if (textureMap) {
+        textures.push_back(textureMap);
     }
+
+    // the material samples this map, so something has to be bound
+    recordParameter(setup, parameterName, textureMap ? textureMap : fallback, sampler);
 }
 
 template<typename VECTOR, typename INDEX>
@@ -530,10 +817,17 @@ void MeshAssimp::addFromFile(const Path &path,
         // std::vectors here.
 
         //TODO: a lot of these method arguments should probably be class or global variables
+        const size_t textureCount = mTextures.size();
         if (!setFromFile(asset, materials)) {
             return;
         }
 
+        int64_t textureBytes = 0;
+        for (size_t i = textureCount; i < mTextures.size(); i++) {
+            textureBytes += ResourceStats::estimateTextureBytes(mTextures[i]);
+        }
+        ResourceStats::track(ResourceStats::Kind::TEXTURE, 0, textureBytes);
+
         VertexBuffer::Builder vertexBufferBuilder = VertexBuffer::Builder()
                 .vertexCount((uint32_t) asset.positions.size())
                 .bufferCount(4)
@@ -576,6 +870,12 @@ void MeshAssimp::addFromFile(const Path &path,
                                    VertexBuffer::BufferDescriptor(t1s->data(), t1s->size(), State<ushort2>::free, t1s));
 
         mIndexBuffer = IndexBuffer::Builder().indexCount(uint32_t(is->size())).build(mEngine);
+
+        // the CPU side copies are released once uploaded, only the GPU buffers remain
+        const int64_t meshBytes = int64_t(ps->size() + ns->size() + t0s->size() + t1s->size() + is->size());
+        mMeshBytes += meshBytes;
+        ResourceStats::track(ResourceStats::Kind::MESH, 0, meshBytes);
+
         mIndexBuffer->setBuffer(mEngine,
                                 IndexBuffer::BufferDescriptor(is->data(), is->size(), State<uint32_t>::free, is));
     }
@@ -647,12 +947,14 @@ void MeshAssimp::addFromFile(const Path &path,
 using Assimp::Importer;
 
 bool MeshAssimp::setFromFile(Asset &asset, std::map<std::string, MaterialInstance *> &outMaterials) {
+    TraceRecorder::Scope importTrace("assimp import", "import");
     Importer importer;
     importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE,
                                 aiPrimitiveType_LINE | aiPrimitiveType_POINT);
     importer.SetPropertyBool(AI_CONFIG_IMPORT_COLLADA_IGNORE_UP_DIRECTION, true);
     importer.SetPropertyBool(AI_CONFIG_PP_PTV_KEEP_HIERARCHY, true);
 
+    const uint64_t readStart = TraceRecorder::isEnabled() ? TraceRecorder::now() : 0;
     aiScene const *scene = importer.ReadFile(asset.file,
             // normals and tangents
                                              aiProcess_GenSmoothNormals |
@@ -668,6 +970,9 @@ bool MeshAssimp::setFromFile(Asset &asset, std::map<std::string, MaterialInstanc
                                              aiProcess_SortByPType |
                                              // we only support triangles
                                              aiProcess_Triangulate);
+    if (readStart) {
+        TraceRecorder::record("assimp read", "import", readStart, TraceRecorder::now());
+    }
 
     size_t index = importer.GetImporterIndex(asset.file.getExtension().c_str());
     const aiImporterDesc *importerDesc = importer.GetImporterInfo(index);
@@ -735,6 +1040,7 @@ bool MeshAssimp::setFromFile(Asset &asset, std::map<std::string, MaterialInstanc
         asset.snormUV1 = minUV1.x >= -1.0f && minUV1.x <= 1.0f && maxUV1.x >= -1.0f && maxUV1.x <= 1.0f &&
                          minUV1.y >= -1.0f && minUV1.y <= 1.0f && maxUV1.y >= -1.0f && maxUV1.y <= 1.0f;
 
+        const uint64_t processStart = TraceRecorder::isEnabled() ? TraceRecorder::now() : 0;
         if (asset.snormUV0) {
             if (asset.snormUV1) {
                 processNode<true, true>(asset, outMaterials,
@@ -752,6 +1058,9 @@ bool MeshAssimp::setFromFile(Asset &asset, std::map<std::string, MaterialInstanc
                                           scene, isGLTF, deep, matCount, node, -1, depth);
             }
         }
+        if (processStart) {
+            TraceRecorder::record("processNode", "import", processStart, TraceRecorder::now());
+        }
 
         // compute the aabb and find bounding box of entire model
         for (auto &mesh: asset.meshes) {
@@ -989,14 +1298,13 @@ void MeshAssimp::processGLTFMaterial(const aiScene *scene, const aiMaterial *mat
     material->Get(AI_MATKEY_GLTF_UNLIT, matConfig.unlit);
 
     aiString alphaMode;
+    float maskThreshold = 0.5;
     material->Get(AI_MATKEY_GLTF_ALPHAMODE, alphaMode);
     if (strcmp(alphaMode.C_Str(), "BLEND") == 0) {
         matConfig.alphaMode = AlphaMode::TRANSPARENT;
     } else if (strcmp(alphaMode.C_Str(), "MASK") == 0) {
         matConfig.alphaMode = AlphaMode::MASKED;
-        float maskThreshold = 0.5;
         material->Get(AI_MATKEY_GLTF_ALPHACUTOFF, maskThreshold);
-        matConfig.maskThreshold = maskThreshold;
     }
 
     material->Get(_AI_MATKEY_GLTF_TEXTURE_TEXCOORD_BASE, AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_TEXTURE,
@@ -1007,36 +1315,59 @@ void MeshAssimp::processGLTFMaterial(const aiScene *scene, const aiMaterial *mat
     material->Get(_AI_MATKEY_GLTF_TEXTURE_TEXCOORD_BASE, aiTextureType_NORMALS, 0, matConfig.normalUV);
     material->Get(_AI_MATKEY_GLTF_TEXTURE_TEXCOORD_BASE, aiTextureType_EMISSIVE, 0, matConfig.emissiveUV);
 
+    matConfig.hasBaseColorMap = material->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_TEXTURE,
+                                                     &baseColorPath) == AI_SUCCESS;
+    matConfig.hasMetallicRoughnessMap = material->GetTexture(
+            AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &MRPath) == AI_SUCCESS;
+    matConfig.hasAOMap = material->GetTexture(aiTextureType_LIGHTMAP, 0, &AOPath) == AI_SUCCESS;
+    matConfig.hasNormalMap = material->GetTexture(aiTextureType_NORMALS, 0, &normalPath) == AI_SUCCESS;
+    matConfig.hasEmissiveMap = material->GetTexture(aiTextureType_EMISSIVE, 0, &emissivePath) == AI_SUCCESS;
+    dropUnusedMaps(matConfig);
+
     uint64_t configHash = hashMaterialConfig(matConfig);
 
-    if (mGltfMaterialCache.find(configHash) == mGltfMaterialCache.end()) {
-        mGltfMaterialCache[configHash] = createMaterialFromConfig(mEngine, matConfig);
+    if (mGltfMaterialCache.find(configHash) == mGltfMaterialCache.end() &&
+        mMaterialBuilds.find(configHash) == mMaterialBuilds.end()) {
+        size_t packageSize = 0;
+        Material *precompiled = loadPrecompiledMaterial(mEngine, matConfig, &packageSize);
+        if (precompiled) {
+            mGltfMaterialCache[configHash] = precompiled;
+            mMaterialBytes += int64_t(packageSize);
+            ResourceStats::track(ResourceStats::Kind::MATERIAL, int64_t(packageSize), 0);
+        }
+#if FILAMENTAPP_RUNTIME_MATERIALS
+        else {
+            // not thread safe, so done here rather than by the workers
+            MaterialBuilder::init();
+            MaterialCache *cache = mMaterialCache;
+            mMaterialBuilds[configHash] = std::async(std::launch::async, [cache, matConfig]() {
+                return buildMaterialPackage(cache, matConfig);
+            });
+        }
+#endif
     }
 
-    outMaterials[materialName] = mGltfMaterialCache[configHash]->createInstance();
+    // the parameters are recorded so they can be applied to an instance created later
+    MaterialSetup setup;
 
-    // TODO: is there a way to use the same material for multiple mask threshold values?
-//    if (matConfig.alphaMode == masked) {
-//        float maskThreshold = 0.5;
-//        material->Get(AI_MATKEY_GLTF_ALPHACUTOFF, maskThreshold);
-//        outMaterials[materialName]->setParameter("maskThreshold", maskThreshold);
-//    }
+    // the cutoff isn't part of the config, so every MASKED material with the same config shares one
+    if (matConfig.alphaMode == AlphaMode::MASKED) {
+        setup.emplace_back([maskThreshold](MaterialInstance *instance) {
+            instance->setMaskThreshold(maskThreshold);
+        });
+    }
 
     // Load property values for gltf files
-    aiColor4D baseColorFactor;
+    aiColor4D baseColorFactor(1.0f, 1.0f, 1.0f, 1.0f);
     aiColor3D emissiveFactor;
     float metallicFactor = 1.0;
     float roughnessFactor = 1.0;
 
     // TODO: is occlusion strength available on Assimp now?
 
-    // Load texture images for gltf files
-    TextureSampler sampler(
-            TextureSampler::MinFilter::LINEAR_MIPMAP_LINEAR,
-            TextureSampler::MagFilter::LINEAR,
-            TextureSampler::WrapMode::REPEAT);
-
-    if (material->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_TEXTURE, &baseColorPath,
+    // Load texture images for gltf files, missing maps have no sampler in the material
+    if (matConfig.hasBaseColorMap &&
+        material->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_TEXTURE, &baseColorPath,
                              nullptr, nullptr, nullptr, nullptr, mapMode) == AI_SUCCESS) {
         unsigned int minType = 0;
         unsigned int magType = 0;
@@ -1044,80 +1375,98 @@ void MeshAssimp::processGLTFMaterial(const aiScene *scene, const aiMaterial *mat
         material->Get("$tex.mappingfiltermag", AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_TEXTURE, magType);
 
         setTextureFromPath(scene, &mEngine, mTextures, baseColorPath,
-                           materialName, dirName, mapMode, "baseColorMap", outMaterials, minType, magType);
-    } else {
-        outMaterials[materialName]->setParameter("baseColorMap", mDefaultMap, sampler);
+                           dirName, mapMode, "baseColorMap", setup, mDefaultMap, minType, magType);
     }
 
-    if (material->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &MRPath,
+    if (matConfig.hasMetallicRoughnessMap &&
+        material->GetTexture(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, &MRPath,
                              nullptr, nullptr, nullptr, nullptr, mapMode) == AI_SUCCESS) {
         unsigned int minType = 0;
         unsigned int magType = 0;
         material->Get("$tex.mappingfiltermin", AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, minType);
         material->Get("$tex.mappingfiltermag", AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLICROUGHNESS_TEXTURE, magType);
 
-        setTextureFromPath(scene, &mEngine, mTextures, MRPath, materialName,
-                           dirName, mapMode, "metallicRoughnessMap", outMaterials, minType, magType);
+        setTextureFromPath(scene, &mEngine, mTextures, MRPath,
+                           dirName, mapMode, "metallicRoughnessMap", setup, mDefaultMap, minType, magType);
     } else {
-        outMaterials[materialName]->setParameter("metallicRoughnessMap", mDefaultMap, sampler);
-        outMaterials[materialName]->setParameter("metallicFactor", mDefaultMetallic);
-        outMaterials[materialName]->setParameter("roughnessFactor", mDefaultRoughness);
+        recordParameter(setup, "metallicFactor", mDefaultMetallic);
+        recordParameter(setup, "roughnessFactor", mDefaultRoughness);
     }
 
-    if (material->GetTexture(aiTextureType_LIGHTMAP, 0, &AOPath, nullptr,
+    if (matConfig.hasAOMap && material->GetTexture(aiTextureType_LIGHTMAP, 0, &AOPath, nullptr,
                              nullptr, nullptr, nullptr, mapMode) == AI_SUCCESS) {
         unsigned int minType = 0;
         unsigned int magType = 0;
         material->Get("$tex.mappingfiltermin", aiTextureType_LIGHTMAP, 0, minType);
         material->Get("$tex.mappingfiltermag", aiTextureType_LIGHTMAP, 0, magType);
-        setTextureFromPath(scene, &mEngine, mTextures, AOPath, materialName,
-                           dirName, mapMode, "aoMap", outMaterials, minType, magType);
-    } else {
-        outMaterials[materialName]->setParameter("aoMap", mDefaultMap, sampler);
+        setTextureFromPath(scene, &mEngine, mTextures, AOPath,
+                           dirName, mapMode, "aoMap", setup, mDefaultMap, minType, magType);
     }
 
-    if (material->GetTexture(aiTextureType_NORMALS, 0, &normalPath, nullptr,
+    if (matConfig.hasNormalMap && material->GetTexture(aiTextureType_NORMALS, 0, &normalPath, nullptr,
                              nullptr, nullptr, nullptr, mapMode) == AI_SUCCESS) {
         unsigned int minType = 0;
         unsigned int magType = 0;
         material->Get("$tex.mappingfiltermin", aiTextureType_NORMALS, 0, minType);
         material->Get("$tex.mappingfiltermag", aiTextureType_NORMALS, 0, magType);
-        setTextureFromPath(scene, &mEngine, mTextures, normalPath, materialName,
-                           dirName, mapMode, "normalMap", outMaterials, minType, magType);
-    } else {
-        outMaterials[materialName]->setParameter("normalMap", mDefaultNormalMap, sampler);
+        setTextureFromPath(scene, &mEngine, mTextures, normalPath,
+                           dirName, mapMode, "normalMap", setup, mDefaultNormalMap, minType, magType);
     }
 
-    if (material->GetTexture(aiTextureType_EMISSIVE, 0, &emissivePath, nullptr,
+    if (matConfig.hasEmissiveMap && material->GetTexture(aiTextureType_EMISSIVE, 0, &emissivePath, nullptr,
                              nullptr, nullptr, nullptr, mapMode) == AI_SUCCESS) {
         unsigned int minType = 0;
         unsigned int magType = 0;
         material->Get("$tex.mappingfiltermin", aiTextureType_EMISSIVE, 0, minType);
         material->Get("$tex.mappingfiltermag", aiTextureType_EMISSIVE, 0, magType);
-        setTextureFromPath(scene, &mEngine, mTextures, emissivePath, materialName,
-                           dirName, mapMode, "emissiveMap", outMaterials, minType, magType);
+        setTextureFromPath(scene, &mEngine, mTextures, emissivePath,
+                           dirName, mapMode, "emissiveMap", setup, mDefaultMap, minType, magType);
     } else {
-        outMaterials[materialName]->setParameter("emissiveMap", mDefaultMap, sampler);
-        outMaterials[materialName]->setParameter("emissiveFactor", mDefaultEmissive);
+        recordParameter(setup, "emissiveFactor", mDefaultEmissive);
     }
 
     //If the gltf has texture factors, override the default factor values
     if (material->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLIC_FACTOR, metallicFactor) == AI_SUCCESS) {
-        outMaterials[materialName]->setParameter("metallicFactor", metallicFactor);
+        recordParameter(setup, "metallicFactor", metallicFactor);
     }
 
     if (material->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_ROUGHNESS_FACTOR, roughnessFactor) == AI_SUCCESS) {
-        outMaterials[materialName]->setParameter("roughnessFactor", roughnessFactor);
+        recordParameter(setup, "roughnessFactor", roughnessFactor);
     }
 
     if (material->Get(AI_MATKEY_COLOR_EMISSIVE, emissiveFactor) == AI_SUCCESS) {
         sRGBColor emissiveFactorCast = *reinterpret_cast<sRGBColor *>(&emissiveFactor);
-        outMaterials[materialName]->setParameter("emissiveFactor", emissiveFactorCast);
+        recordParameter(setup, "emissiveFactor", emissiveFactorCast);
     }
 
     if (material->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_BASE_COLOR_FACTOR, baseColorFactor) == AI_SUCCESS) {
         sRGBColorA baseColorFactorCast = *reinterpret_cast<sRGBColorA *>(&baseColorFactor);
-        outMaterials[materialName]->setParameter("baseColorFactor", baseColorFactorCast);
+        recordParameter(setup, "baseColorFactor", baseColorFactorCast);
+    }
+
+    auto built = mGltfMaterialCache.find(configHash);
+    if (built != mGltfMaterialCache.end()) {
+        TraceRecorder::Scope trace("material instance", "material");
+        MaterialInstance *instance = built->second->createInstance();
+        for (auto const &set: setup) {
+            set(instance);
+        }
+        outMaterials[materialName] = instance;
+    } else {
+        // rendered with the default material until updateMaterials() finds the build done
+        MaterialInstance *placeholder;
+        if (matConfig.alphaMode == AlphaMode::TRANSPARENT) {
+            placeholder = mDefaultTransparentColorMaterial->createInstance();
+            placeholder->setParameter("baseColor", RgbaType::sRGB, sRGBColorA{baseColorFactor.r,
+                    baseColorFactor.g, baseColorFactor.b, baseColorFactor.a});
+        } else {
+            placeholder = mDefaultColorMaterial->createInstance();
+            placeholder->setParameter("baseColor", RgbType::sRGB, sRGBColor{baseColorFactor.r,
+                    baseColorFactor.g, baseColorFactor.b});
+        }
+        outMaterials[materialName] = placeholder;
+        mPendingMaterials.push_back({ configHash, materialName, &outMaterials, placeholder,
+                                      std::move(setup) });
     }
 
     aiBool isSpecularGlossiness = false;
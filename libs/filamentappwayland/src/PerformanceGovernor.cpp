@@ -0,0 +1,202 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/PerformanceGovernor.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#include <filament/Engine.h>
+#include <filament/Scene.h>
+
+using namespace filament;
+
+static constexpr double DEGRADE_LOAD = 1.05;        // over budget above this
+static constexpr double RESTORE_LOAD = 0.75;        // well under budget below this
+static constexpr double MISSED_INTERVAL = 1.5;      // a vblank was missed above this
+static constexpr uint32_t DEGRADE_FRAMES = 30;
+static constexpr uint32_t RESTORE_FRAMES = 180;
+static constexpr uint32_t THERMAL_PERIOD = 60;      // frames between two reads
+static constexpr float THERMAL_HYSTERESIS = 5.0f;   // degrees under the limit to restore
+
+bool PerformanceGovernor::update(Engine &engine, View *view, Scene *scene,
+                                 float cpuMs, float gpuMs, double frameInterval, double budget,
+                                 bool sceneChanged) {
+    if (!mEnabled || budget <= 0.0) {
+        return false;
+    }
+
+    if (sceneChanged && mSaved) {
+        collectShadowCasters(engine, scene);
+        apply(engine, view, mLevel);
+    }
+
+    // After an idle period or a hitch the interval says nothing about the current load.
+    if (frameInterval > budget * 4.0) {
+        return false;
+    }
+
+    // The interval is paced to the budget, only the work itself shows the headroom.
+    const double frameTime = (double(cpuMs) + double(gpuMs)) / 1000.0;
+    mLoad += (frameTime / budget - mLoad) * 0.1;
+    const bool missed = frameInterval > budget * MISSED_INTERVAL;
+
+    bool hot = false;
+    bool cool = true;
+    if (mThermalLimit > 0.0f) {
+        if (mThermalAge-- == 0) {
+            mThermalAge = THERMAL_PERIOD;
+            mTemperature = readTemperature();
+        }
+        hot = mTemperature >= mThermalLimit;
+        cool = mTemperature < mThermalLimit - THERMAL_HYSTERESIS;
+    }
+
+    if (mLoad > DEGRADE_LOAD || missed || hot) {
+        mUnderBudget = 0;
+        mOverBudget++;
+    } else if (mLoad < RESTORE_LOAD && cool) {
+        mOverBudget = 0;
+        mUnderBudget++;
+    } else {
+        mOverBudget = 0;
+        mUnderBudget = 0;
+    }
+
+    uint8_t level = mLevel;
+    if (mOverBudget >= DEGRADE_FRAMES && level + 1 < LEVEL_COUNT) {
+        level++;
+    } else if (mUnderBudget >= RESTORE_FRAMES && level > FULL) {
+        level--;
+    }
+    if (level == mLevel) {
+        return false;
+    }
+
+    // start over, the new level needs time to show its effect
+    mOverBudget = 0;
+    mUnderBudget = 0;
+
+    if (!mSaved) {
+        save(engine, view, scene);
+    }
+    apply(engine, view, level);
+    return true;
+}
+
+void PerformanceGovernor::restore(Engine &engine, View *view) {
+    if (mSaved && mLevel != FULL) {
+        apply(engine, view, FULL);
+    }
+    mSaved = false;
+    mOriginal.shadows.clear();
+    mLoad = 0.0;
+    mOverBudget = 0;
+    mUnderBudget = 0;
+}
+
+void PerformanceGovernor::save(Engine &engine, View *view, Scene *scene) {
+    mOriginal.antiAliasing = view->getAntiAliasing();
+    mOriginal.msaa = view->getMultiSampleAntiAliasingOptions();
+    mOriginal.ssao = view->getAmbientOcclusionOptions();
+    mOriginal.bloom = view->getBloomOptions();
+    mOriginal.dynamicResolution = view->getDynamicResolutionOptions();
+
+    mOriginal.shadows.clear();
+    collectShadowCasters(engine, scene);
+    mSaved = true;
+}
+
+void PerformanceGovernor::collectShadowCasters(Engine &engine, Scene *scene) {
+    auto &lm = engine.getLightManager();
+    auto &shadows = mOriginal.shadows;
+    shadows.erase(std::remove_if(shadows.begin(), shadows.end(), [&lm](auto const &item) {
+        return !lm.getInstance(item.first);
+    }), shadows.end());
+    scene->forEach([&](utils::Entity entity) {
+        auto instance = lm.getInstance(entity);
+        if (!instance || !lm.isShadowCaster(instance)) {
+            return;
+        }
+        auto known = std::find_if(shadows.begin(), shadows.end(), [entity](auto const &item) {
+            return item.first == entity;
+        });
+        if (known == shadows.end()) {
+            shadows.emplace_back(entity, lm.getShadowOptions(instance));
+        }
+    });
+}
+
+void PerformanceGovernor::apply(Engine &engine, View *view, uint8_t level) {
+    mLevel = level;
+
+    auto dynamicResolution = mOriginal.dynamicResolution;
+    if (level >= DYNAMIC_RESOLUTION && !dynamicResolution.enabled) {
+        dynamicResolution.enabled = true;
+        dynamicResolution.minScale = {0.6f, 0.6f};
+        dynamicResolution.maxScale = {1.0f, 1.0f};
+    }
+    view->setDynamicResolutionOptions(dynamicResolution);
+
+    auto msaa = mOriginal.msaa;
+    auto antiAliasing = mOriginal.antiAliasing;
+    if (level >= NO_MSAA && msaa.enabled) {
+        msaa.enabled = false;
+        antiAliasing = AntiAliasing::FXAA;
+    }
+    view->setMultiSampleAntiAliasingOptions(msaa);
+    view->setAntiAliasing(antiAliasing);
+
+    auto ssao = mOriginal.ssao;
+    ssao.enabled = ssao.enabled && level < NO_SSAO;
+    view->setAmbientOcclusionOptions(ssao);
+
+    auto bloom = mOriginal.bloom;
+    bloom.enabled = bloom.enabled && level < NO_BLOOM;
+    view->setBloomOptions(bloom);
+
+    auto &lm = engine.getLightManager();
+    for (auto const &item: mOriginal.shadows) {
+        auto instance = lm.getInstance(item.first);
+        if (!instance) {
+            continue;   // destroyed since
+        }
+        auto options = item.second;
+        if (level >= LOW_SHADOWS) {
+            options.mapSize = std::min(options.mapSize, 512u);
+        }
+        if (level >= NO_CONTACT_SHADOWS) {
+            options.screenSpaceContactShadows = false;
+        }
+        lm.setShadowOptions(instance, options);
+    }
+}
+
+float PerformanceGovernor::readTemperature() {
+    float hottest = 0.0f;
+    for (int zone = 0;; zone++) {
+        std::ifstream file("/sys/class/thermal/thermal_zone" + std::to_string(zone) + "/temp");
+        if (!file) {
+            break;
+        }
+        long milliCelsius = 0;
+        if (file >> milliCelsius) {
+            hottest = std::max(hottest, float(milliCelsius) / 1000.0f);
+        }
+    }
+    return hottest;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/PhaseTimings.h>
+
+#include <algorithm>
+
+const char *PhaseTimings::getName(Phase phase) {
+    switch (phase) {
+        case Phase::FRAME: return "frame";
+        case Phase::EXECUTE: return "execute";
+        case Phase::UPDATE: return "update";
+        case Phase::ANIMATION: return "animation";
+        case Phase::MANIPULATORS: return "manipulators";
+        case Phase::FRUSTUM: return "frustum";
+        case Phase::OFFSCREEN_VIEWS: return "offscreen views";
+        case Phase::VIEW_0: return "view 0";
+        case Phase::VIEW_1: return "view 1";
+        case Phase::VIEW_2: return "view 2";
+        case Phase::VIEW_3: return "view 3";
+        case Phase::END_FRAME: return "endFrame";
+        case Phase::COUNT: break;
+    }
+    return "unknown";
+}
+
+// Below 4us one bucket per microsecond, above that four buckets per power of two.
+size_t PhaseTimings::bucketIndex(uint64_t us) {
+    if (us < 4) {
+        return size_t(us);
+    }
+    const auto msb = size_t(63 - __builtin_clzll(us));
+    const auto sub = size_t(us >> (msb - 2)) & 3u;
+    return std::min((msb - 1) * 4 + sub, BUCKET_COUNT - 1);
+}
+
+uint64_t PhaseTimings::bucketStart(size_t index) {
+    if (index < 4) {
+        return index;
+    }
+    const size_t msb = index / 4 + 1;
+    const size_t sub = index % 4;
+    return uint64_t(4 + sub) << (msb - 2);
+}
+
+void PhaseTimings::record(Phase phase, std::chrono::nanoseconds duration) {
+    auto &histogram = mHistograms[size_t(phase)];
+    const auto ns = uint64_t(std::max(duration.count(), decltype(duration.count())(0)));
+
+    histogram.buckets[bucketIndex(ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+    // single writer, a plain compare is enough
+    if (ns < histogram.minNs.load(std::memory_order_relaxed)) {
+        histogram.minNs.store(ns, std::memory_order_relaxed);
+    }
+    if (ns > histogram.maxNs.load(std::memory_order_relaxed)) {
+        histogram.maxNs.store(ns, std::memory_order_relaxed);
+    }
+}
+
+PhaseTimings::Summary PhaseTimings::summary(Phase phase) const {
+    const auto &histogram = mHistograms[size_t(phase)];
+
+    std::array<uint32_t, BUCKET_COUNT> buckets{};
+    uint64_t count = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+        count += buckets[i];
+    }
+
+    Summary summary;
+    if (!count) {
+        return summary;
+    }
+
+    constexpr float NS_TO_MS = 1e-6f;
+    summary.count = count;
+    summary.minMs = float(histogram.minNs.load(std::memory_order_relaxed)) * NS_TO_MS;
+    summary.maxMs = float(histogram.maxNs.load(std::memory_order_relaxed)) * NS_TO_MS;
+    summary.meanMs = float(histogram.totalNs.load(std::memory_order_relaxed)) * NS_TO_MS /
+                     float(std::max(histogram.count.load(std::memory_order_relaxed), uint64_t(1)));
+
+    // middle of the bucket holding the sample, kept within the exact min and max
+    auto percentile = [&](uint64_t p) {
+        const uint64_t rank = (count - 1) * p / 100;
+        uint64_t seen = 0;
+        size_t index = 0;
+        for (; index < BUCKET_COUNT - 1; index++) {
+            seen += buckets[index];
+            if (seen > rank) {
+                break;
+            }
+        }
+        const uint64_t start = bucketStart(index);
+        const uint64_t end = index < BUCKET_COUNT - 1 ? bucketStart(index + 1) : start + 1;
+        const float ms = float(start + end) * 0.5f * 1e-3f;
+        return std::clamp(ms, summary.minMs, std::max(summary.minMs, summary.maxMs));
+    };
+    summary.p50Ms = percentile(50);
+    summary.p95Ms = percentile(95);
+    summary.p99Ms = percentile(99);
+    return summary;
+}
+
+void PhaseTimings::reset() {
+    for (auto &histogram: mHistograms) {
+        for (auto &bucket: histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.totalNs.store(0, std::memory_order_relaxed);
+        histogram.minNs.store(UINT64_MAX, std::memory_order_relaxed);
+        histogram.maxNs.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/ReadbackRing.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <filament/Renderer.h>
+#include <filament/Texture.h>
+
+using namespace filament;
+
+ReadbackRing::ReadbackRing(uint32_t bufferCount, FrameCallback callback)
+        : mShared(std::make_shared<Shared>()) {
+    mShared->callback = std::move(callback);
+    mShared->count = std::clamp(bufferCount, 1u, MAX_BUFFERS);
+}
+
+ReadbackRing::~ReadbackRing() {
+    // reads still in flight complete into the shared state, but nobody is told about them
+    mShared->detached.store(true, std::memory_order_release);
+}
+
+bool ReadbackRing::readFrame(Renderer *renderer, uint32_t width, uint32_t height) {
+    Shared &shared = *mShared;
+
+    uint32_t index = shared.count;
+    for (uint32_t i = 0; i < shared.count; i++) {
+        const uint32_t candidate = (mNext + i) % shared.count;
+        if (shared.slots[candidate].state.load(std::memory_order_acquire) == FREE) {
+            index = candidate;
+            break;
+        }
+    }
+    if (index == shared.count) {
+        mDroppedFrames++;
+        return false;
+    }
+    mNext = (index + 1) % shared.count;
+
+    // a free slot isn't referenced by anyone, it can be resized in place
+    Slot &slot = shared.slots[index];
+    const size_t size = size_t(width) * height * 4;
+    if (slot.capacity < size) {
+        slot.data.reset(new uint8_t[size]);
+        slot.capacity = size;
+    }
+    slot.width = width;
+    slot.height = height;
+    slot.state.store(READING, std::memory_order_relaxed);
+
+    auto *pending = new Pending{mShared, index};
+    renderer->readPixels(0, 0, width, height,
+                         Texture::PixelBufferDescriptor(slot.data.get(), size,
+                                                        Texture::Format::RGBA, Texture::Type::UBYTE,
+                                                        &ReadbackRing::onReadComplete, pending));
+    return true;
+}
+
+void ReadbackRing::onReadComplete(void *buffer, size_t, void *user) {
+    std::unique_ptr<Pending> pending(static_cast<Pending *>(user));
+    Shared &shared = *pending->shared;
+    Slot &slot = shared.slots[pending->index];
+
+    if (shared.detached.load(std::memory_order_acquire) || !shared.callback) {
+        slot.state.store(FREE, std::memory_order_release);
+        return;
+    }
+
+    slot.state.store(HELD, std::memory_order_release);
+    shared.callback(pending->index, buffer, slot.width, slot.height, slot.width * 4);
+}
+
+void ReadbackRing::release(uint32_t index) {
+    if (index >= mShared->count) {
+        return;
+    }
+    uint8_t expected = HELD;
+    mShared->slots[index].state.compare_exchange_strong(expected, FREE, std::memory_order_release);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/ResourceStats.h>
+
+#include <filament/Texture.h>
+
+using namespace filament;
+
+std::atomic<int64_t> ResourceStats::sCpuBytes[KIND_COUNT] = {};
+std::atomic<int64_t> ResourceStats::sGpuBytes[KIND_COUNT] = {};
+
+void ResourceStats::track(Kind kind, int64_t cpuBytes, int64_t gpuBytes) {
+    sCpuBytes[size_t(kind)].fetch_add(cpuBytes, std::memory_order_relaxed);
+    sGpuBytes[size_t(kind)].fetch_add(gpuBytes, std::memory_order_relaxed);
+}
+
+int64_t ResourceStats::getCpuBytes(Kind kind) {
+    return sCpuBytes[size_t(kind)].load(std::memory_order_relaxed);
+}
+
+int64_t ResourceStats::getGpuBytes(Kind kind) {
+    return sGpuBytes[size_t(kind)].load(std::memory_order_relaxed);
+}
+
+int64_t ResourceStats::estimateTextureBytes(const Texture *texture) {
+    if (!texture) {
+        return 0;
+    }
+
+    int64_t bytesPerPixel;
+    switch (texture->getFormat()) {
+        case Texture::InternalFormat::R8:
+            bytesPerPixel = 1;
+            break;
+        case Texture::InternalFormat::RG8:
+        case Texture::InternalFormat::R16F:
+            bytesPerPixel = 2;
+            break;
+        case Texture::InternalFormat::RGBA16F:
+        case Texture::InternalFormat::RG32F:
+            bytesPerPixel = 8;
+            break;
+        case Texture::InternalFormat::RGB32F:
+        case Texture::InternalFormat::RGBA32F:
+            bytesPerPixel = 16;
+            break;
+        default:
+            // 8-bit RGB formats are padded to 4 bytes by most drivers, same as R11F_G11F_B10F
+            bytesPerPixel = 4;
+            break;
+    }
+
+    const int64_t faces = texture->getTarget() == Texture::Sampler::SAMPLER_CUBEMAP ? 6 : 1;
+
+    int64_t total = 0;
+    for (size_t level = 0; level < texture->getLevels(); level++) {
+        total += int64_t(texture->getWidth(level)) * texture->getHeight(level) *
+                 texture->getDepth(level) * bytesPerPixel;
+    }
+    return total * faces;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/SharedEngine.h>
+#include <filamentappwayland/ResourceStats.h>
+#include <filamentappwayland/TraceRecorder.h>
+
+#include <cassert>
+#include <iostream>
+
+#include <filament/Material.h>
+#include <filament/MaterialEnums.h>
+#include <filament/Texture.h>
+
+#include <utils/Path.h>
+
+#ifndef FILAMENTAPP_VULKAN_PIPELINE_CACHE
+#define FILAMENTAPP_VULKAN_PIPELINE_CACHE 0
+#endif
+
+#if FILAMENTAPP_VULKAN_PIPELINE_CACHE
+#include <backend/PipelineCache.h>
+#endif
+
+#include <stb_image.h>
+
+#include "generated/resources/filamentappwl.h"
+
+using namespace filament;
+using namespace utils;
+
+// Filament keeps a copy of each material package for the lifetime of the material.
+static int64_t debugMaterialPackageBytes() {
+#if FILAMENTAPP_DEBUG_VIEWS
+    return int64_t(FILAMENTAPPWL_DEPTHVISUALIZER_SIZE) + FILAMENTAPPWL_AIDEFAULTMAT_SIZE +
+           FILAMENTAPPWL_TRANSPARENTCOLOR_SIZE;
+#else
+    return 0;
+#endif
+}
+
+// With COMP_SURF_VULKAN_PIPELINE_CACHE the Vulkan backend keeps its VkPipelineCache in
+// <cachePath>/pipelines (third_party/0004-Vulkan-pipeline-cache.patch), data from another device
+// or driver build is discarded on load. This has to happen before the engine is created.
+static void configurePipelineCache(const std::string &cachePath) {
+#if FILAMENTAPP_VULKAN_PIPELINE_CACHE
+    if (cachePath.empty()) {
+        backend::setPipelineCacheDirectory(nullptr);
+        return;
+    }
+    Path dir = Path::concat(cachePath, "pipelines");
+    if (!dir.isDirectory() && !dir.mkdirRecursive()) {
+        std::cerr << "Unable to create pipeline cache directory: " << dir << std::endl;
+        backend::setPipelineCacheDirectory(nullptr);
+        return;
+    }
+    backend::setPipelineCacheDirectory(dir.getAbsolutePath().c_str());
+#else
+    (void) cachePath;
+#endif
+}
+
+std::mutex SharedEngine::sMutex;
+std::weak_ptr<SharedEngine> SharedEngine::sInstance;
+
+std::shared_ptr<SharedEngine> SharedEngine::acquire(const Config &config) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    std::shared_ptr<SharedEngine> shared = sInstance.lock();
+    if (!shared) {
+        shared.reset(new SharedEngine(config));
+        sInstance = shared;
+    } else {
+        // later contexts inherit whatever the first context resolved
+        config.backend = shared->mBackend;
+        config.featureLevel = shared->mEngine->getActiveFeatureLevel();
+        if (config.hasDebugViews()) {
+            shared->createDebugMaterials();
+        }
+    }
+    return shared;
+}
+
+SharedEngine::SharedEngine(const Config &config) {
+    configurePipelineCache(config.cachePath);
+    mEngine = Engine::create(config.backend);
+
+    // get the resolved backend
+    mBackend = config.backend = mEngine->getBackend();
+
+    // Select the feature level to use
+    config.featureLevel = std::min(config.featureLevel, mEngine->getSupportedFeatureLevel());
+    mEngine->setActiveFeatureLevel(config.featureLevel);
+
+    if (config.hasDebugViews()) {
+        createDebugMaterials();
+    }
+
+    if (!config.cachePath.empty()) {
+        Path dir = Path::concat(config.cachePath, "materials");
+        if (dir.isDirectory() || dir.mkdirRecursive()) {
+            // packages only load on the backend, feature level, material format and filament
+            // build they were built for
+            const std::string tag = "b" + std::to_string(int(mBackend)) +
+                                    "-f" + std::to_string(int(config.featureLevel)) +
+                                    "-m" + std::to_string(MATERIAL_VERSION) +
+                                    "-" + FILAMENT_BUILD_ID;
+            mMaterialCache = std::make_unique<MaterialCache>(dir.getAbsolutePath(), tag);
+        } else {
+            std::cerr << "Unable to create material cache directory: " << dir << std::endl;
+        }
+    }
+}
+
+void SharedEngine::createDebugMaterials() {
+#if FILAMENTAPP_DEBUG_VIEWS
+    if (mDepthMaterial) {
+        return;
+    }
+
+    TraceRecorder::Scope trace("shared materials", "material");
+    mDepthMaterial = Material::Builder()
+            .package(FILAMENTAPPWL_DEPTHVISUALIZER_DATA, FILAMENTAPPWL_DEPTHVISUALIZER_SIZE)
+            .build(*mEngine);
+
+    mDefaultMaterial = Material::Builder()
+            .package(FILAMENTAPPWL_AIDEFAULTMAT_DATA, FILAMENTAPPWL_AIDEFAULTMAT_SIZE)
+            .build(*mEngine);
+
+    mTransparentMaterial = Material::Builder()
+            .package(FILAMENTAPPWL_TRANSPARENTCOLOR_DATA, FILAMENTAPPWL_TRANSPARENTCOLOR_SIZE)
+            .build(*mEngine);
+
+    ResourceStats::track(ResourceStats::Kind::MATERIAL, debugMaterialPackageBytes(), 0);
+#endif
+}
+
+SharedEngine::~SharedEngine() {
+    mIBLs.clear();
+    for (auto &item: mDirtTextures) {
+        ResourceStats::track(ResourceStats::Kind::TEXTURE, 0,
+                             -ResourceStats::estimateTextureBytes(item.second));
+        mEngine->destroy(item.second);
+    }
+    if (mDepthMaterial) {
+        ResourceStats::track(ResourceStats::Kind::MATERIAL, -debugMaterialPackageBytes(), 0);
+        mEngine->destroy(mDepthMaterial);
+        mEngine->destroy(mDefaultMaterial);
+        mEngine->destroy(mTransparentMaterial);
+    }
+    Engine::destroy(&mEngine);
+}
+
+IBL *SharedEngine::getIBL(const std::string &path, IBL::KtxPayload *payload) {
+    auto pos = mIBLs.find(path);
+    if (pos != mIBLs.end()) {
+        return pos->second.get();
+    }
+
+    // failures are cached as well, so that every context doesn't retry the same path
+    std::unique_ptr<IBL> &ibl = mIBLs[path];
+
+    Path iblPath(path);
+    if (!iblPath.exists()) {
+        std::cerr << "The specified IBL path does not exist: " << iblPath << std::endl;
+        return nullptr;
+    }
+
+    ibl = std::make_unique<IBL>(*mEngine);
+
+    if (payload && ibl->loadFromPayload(*payload)) {
+        return ibl.get();
+    }
+
+    if (!iblPath.isDirectory()) {
+        if (!ibl->loadFromEquirect(iblPath)) {
+            std::cerr << "Could not load the specified IBL: " << iblPath << std::endl;
+            ibl.reset(nullptr);
+        }
+    } else {
+        if (!ibl->loadFromDirectory(iblPath)) {
+            std::cerr << "Could not load the specified IBL: " << iblPath << std::endl;
+            ibl.reset(nullptr);
+        }
+    }
+    return ibl.get();
+}
+
+Texture *SharedEngine::getDirt(const std::string &path) {
+    auto pos = mDirtTextures.find(path);
+    if (pos != mDirtTextures.end()) {
+        return pos->second;
+    }
+
+    Texture *&dirt = mDirtTextures[path];
+
+    Path dirtPath(path);
+
+    if (!dirtPath.exists()) {
+        std::cerr << "The specified dirt file does not exist: " << dirtPath << std::endl;
+        return nullptr;
+    }
+
+    if (!dirtPath.isFile()) {
+        std::cerr << "The specified dirt path is not a file: " << dirtPath << std::endl;
+        return nullptr;
+    }
+
+    int w, h, n;
+
+    unsigned char *data = stbi_load(dirtPath.getAbsolutePath().c_str(), &w, &h, &n, 3);
+    assert(n == 3);
+
+    dirt = Texture::Builder()
+            .width(w)
+            .height(h)
+            .format(Texture::InternalFormat::RGB8)
+            .build(*mEngine);
+
+    dirt->setImage(*mEngine, 0, {data, size_t(w * h * 3),
+                                 Texture::Format::RGB, Texture::Type::UBYTE,
+                                 (Texture::PixelBufferDescriptor::Callback) &stbi_image_free});
+    ResourceStats::track(ResourceStats::Kind::TEXTURE, 0, ResourceStats::estimateTextureBytes(dirt));
+    return dirt;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/TaskQueue.h>
+
+#include <utility>
+#include <vector>
+
+void TaskQueue::post(Task task, Priority priority) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mQueues[size_t(priority)].push_back(std::move(task));
+}
+
+size_t TaskQueue::run(std::chrono::microseconds budget) {
+    using clock = std::chrono::steady_clock;
+    const auto deadline = clock::now() + budget;
+
+    // blocked tasks are put back once we're done, so they don't eat this run's budget
+    std::vector<std::pair<size_t, Task>> blocked;
+
+    do {
+        Task task;
+        size_t priority = 0;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            while (priority < PRIORITY_COUNT && mQueues[priority].empty()) {
+                priority++;
+            }
+            if (priority == PRIORITY_COUNT) {
+                break;
+            }
+            task = std::move(mQueues[priority].front());
+            mQueues[priority].pop_front();
+        }
+
+        // the lock isn't held while the task runs, it may post more work
+        Status status = task();
+
+        if (status == Status::PENDING) {
+            std::lock_guard<std::mutex> lock(mLock);
+            mQueues[priority].push_front(std::move(task));
+        } else if (status == Status::BLOCKED) {
+            blocked.emplace_back(priority, std::move(task));
+        }
+    } while (clock::now() < deadline);
+
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto &item: blocked) {
+        mQueues[item.first].push_back(std::move(item.second));
+    }
+    size_t remaining = 0;
+    for (auto const &queue: mQueues) {
+        remaining += queue.size();
+    }
+    return remaining;
+}
+
+size_t TaskQueue::size() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    size_t count = 0;
+    for (auto const &queue: mQueues) {
+        count += queue.size();
+    }
+    return count;
+}
+
+void TaskQueue::clear() {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto &queue: mQueues) {
+        queue.clear();
+    }
+}
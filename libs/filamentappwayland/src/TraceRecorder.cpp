@@ -0,0 +1,177 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/TraceRecorder.h>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+// Each slot is a small seqlock: sequence is 0 while the slot is being written, then the position
+// of the event in the stream plus one, which tells the reader whether it was overwritten.
+struct TraceRecorder::Event {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<const char *> category{nullptr};
+    std::atomic<uint64_t> startNs{0};
+    std::atomic<uint64_t> endNs{0};
+    std::atomic<uint32_t> tid{0};
+};
+
+struct TraceRecorder::Ring {
+    explicit Ring(size_t capacity) : capacity(capacity), events(new Event[capacity]) {}
+
+    const size_t capacity;
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint64_t> head{0};
+    uint64_t originNs = 0;
+
+    // Recorders may still hold a ring that enable() replaced, so rings are never freed.
+    std::unique_ptr<Ring> previous;
+};
+
+std::atomic<bool> TraceRecorder::sEnabled{false};
+std::atomic<TraceRecorder::Ring *> TraceRecorder::sRing{nullptr};
+
+namespace {
+    std::mutex sEnableLock;
+
+    uint32_t currentThreadId() {
+        thread_local const auto tid = uint32_t(syscall(SYS_gettid));
+        return tid;
+    }
+
+    void writeString(std::ostream &out, const char *str) {
+        out << '"';
+        for (const char *c = str ? str : ""; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\';
+            }
+            out << *c;
+        }
+        out << '"';
+    }
+}  // namespace
+
+uint64_t TraceRecorder::now() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void TraceRecorder::enable(size_t capacity) {
+    std::lock_guard<std::mutex> lock(sEnableLock);
+
+    capacity = std::max(capacity, size_t(1));
+    Ring *ring = sRing.load(std::memory_order_relaxed);
+    if (!ring || ring->capacity != capacity) {
+        auto *next = new Ring(capacity);
+        next->previous.reset(ring);
+        ring = next;
+    } else {
+        for (size_t i = 0; i < ring->capacity; i++) {
+            ring->events[i].sequence.store(0, std::memory_order_relaxed);
+        }
+        ring->head.store(0, std::memory_order_relaxed);
+    }
+    ring->originNs = now();
+
+    sRing.store(ring, std::memory_order_release);
+    sEnabled.store(true, std::memory_order_release);
+}
+
+void TraceRecorder::disable() {
+    sEnabled.store(false, std::memory_order_relaxed);
+}
+
+void TraceRecorder::record(const char *name, const char *category, uint64_t startNs,
+                           uint64_t endNs) {
+    Ring *ring = sRing.load(std::memory_order_acquire);
+    if (!ring) {
+        return;
+    }
+
+    const uint64_t position = ring->head.fetch_add(1, std::memory_order_relaxed);
+    Event &event = ring->events[position % ring->capacity];
+    event.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.category.store(category, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.endNs.store(endNs, std::memory_order_relaxed);
+    event.tid.store(currentThreadId(), std::memory_order_relaxed);
+    event.sequence.store(position + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::write(const std::string &path) {
+    const Ring *ring = sRing.load(std::memory_order_acquire);
+    if (!ring) {
+        return false;
+    }
+
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Could not write trace to " << path << std::endl;
+        return false;
+    }
+
+    const auto pid = uint32_t(getpid());
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t first = head > ring->capacity ? head - ring->capacity : 0;
+
+    out << R"({"displayTimeUnit":"ms","traceEvents":[)";
+    out << std::fixed << std::setprecision(3);
+    bool separator = false;
+    for (uint64_t position = first; position < head; position++) {
+        const Event &event = ring->events[position % ring->capacity];
+        const uint64_t before = event.sequence.load(std::memory_order_acquire);
+        const char *name = event.name.load(std::memory_order_relaxed);
+        const char *category = event.category.load(std::memory_order_relaxed);
+        const uint64_t startNs = event.startNs.load(std::memory_order_relaxed);
+        const uint64_t endNs = event.endNs.load(std::memory_order_relaxed);
+        const uint32_t tid = event.tid.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t after = event.sequence.load(std::memory_order_relaxed);
+        if (before != position + 1 || after != before || startNs < ring->originNs) {
+            // still being written, or already overwritten by a newer event
+            continue;
+        }
+
+        // complete events, timestamps and durations in microseconds
+        out << (separator ? ",\n" : "\n") << R"({"ph":"X","name":)";
+        writeString(out, name);
+        out << R"(,"cat":)";
+        writeString(out, category);
+        out << R"(,"ts":)" << double(startNs - ring->originNs) * 1e-3
+            << R"(,"dur":)" << double(endNs - startNs) * 1e-3
+            << R"(,"pid":)" << pid << R"(,"tid":)" << tid << '}';
+        separator = true;
+    }
+    out << "\n]}\n";
+
+    out.close();
+    if (!out) {
+        std::cerr << "Could not write trace to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
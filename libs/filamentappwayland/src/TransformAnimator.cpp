@@ -0,0 +1,113 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <filamentappwayland/TransformAnimator.h>
+
+#include <cmath>
+
+#include <filament/TransformManager.h>
+
+#include <math/norm.h>
+
+using namespace filament;
+using namespace filament::math;
+
+void TransformAnimator::add(utils::Entity entity, const mat4f &base, float3 axis, float speed, float phase) {
+    mEntities.push_back(entity);
+    mBases.push_back(base);
+    mAxes.push_back(normalize(axis));
+    mSpeeds.push_back(speed);
+    mPhases.push_back(phase);
+}
+
+void TransformAnimator::remove(utils::Entity entity) {
+    for (size_t i = 0; i < mEntities.size(); i++) {
+        if (mEntities[i] == entity) {
+            // order doesn't matter, swap with the last one
+            mEntities[i] = mEntities.back();
+            mBases[i] = mBases.back();
+            mAxes[i] = mAxes.back();
+            mSpeeds[i] = mSpeeds.back();
+            mPhases[i] = mPhases.back();
+            mEntities.pop_back();
+            mBases.pop_back();
+            mAxes.pop_back();
+            mSpeeds.pop_back();
+            mPhases.pop_back();
+            return;
+        }
+    }
+}
+
+void TransformAnimator::clear() {
+    mEntities.clear();
+    mBases.clear();
+    mAxes.clear();
+    mSpeeds.clear();
+    mPhases.clear();
+}
+
+void TransformAnimator::reserve(size_t count) {
+    mEntities.reserve(count);
+    mBases.reserve(count);
+    mAxes.reserve(count);
+    mSpeeds.reserve(count);
+    mPhases.reserve(count);
+}
+
+void TransformAnimator::update(TransformManager &tcm, double time) const {
+    const size_t count = mEntities.size();
+    if (!count) {
+        return;
+    }
+
+    tcm.openLocalTransformTransaction();
+    for (size_t i = 0; i < count; i++) {
+        // Instances aren't cached, destroying any transform component renumbers them.
+        auto instance = tcm.getInstance(mEntities[i]);
+        if (instance) {
+            mat4f transform;
+            evaluate(time, i, 1, &transform);
+            tcm.setTransform(instance, transform);
+        }
+    }
+    tcm.commitLocalTransformTransaction();
+}
+
+void TransformAnimator::evaluate(double time, size_t start, size_t count, mat4f *out) const {
+    for (size_t i = 0; i < count; i++) {
+        const size_t index = start + i;
+        // keep the angle small, float precision degrades quickly as time grows
+        const double angle = std::fmod(mPhases[index] + mSpeeds[index] * time, 2.0 * M_PI);
+        out[i] = mBases[index] * mat4f::rotation(angle, mAxes[index]);
+    }
+}
+
+void TransformAnimator::apply(TransformManager &tcm, const mat4f *transforms) const {
+    const size_t count = mEntities.size();
+    if (!count) {
+        return;
+    }
+
+    tcm.openLocalTransformTransaction();
+    for (size_t i = 0; i < count; i++) {
+        auto instance = tcm.getInstance(mEntities[i]);
+        if (instance) {
+            tcm.setTransform(instance, transforms[i]);
+        }
+    }
+    tcm.commitLocalTransformTransaction();
+}
@@ -15,6 +15,11 @@
  */
 
 #include "context.h"
+#include "vulkan_loader.h"
+
+#include <iostream>
+
+#include <filamentappwayland/TraceRecorder.h>
 
 #include "generated/resources/resources.h"
 #include "generated/resources/monkey.h"
@@ -36,7 +41,9 @@ CompSurfContext::CompSurfContext(const char *accessToken,
                                  void *nativeWindow,
                                  const char *assetsPath,
                                  const char *cachePath,
-                                 const char *miscPath)
+                                 const char *miscPath,
+                                 bool async,
+                                 ReadyCallback onReady)
         : mAccessToken(accessToken),
           mAssetsPath(assetsPath),
           mCachePath(cachePath),
@@ -46,21 +53,38 @@ CompSurfContext::CompSurfContext(const char *accessToken,
 
     mConfig.title = "hellopbr";
     mConfig.assetPath = assetsPath;
+    mConfig.cachePath = mCachePath;
     mConfig.width = mWidth;
     mConfig.height = mHeight;
     mConfig.native_window = nativeWindow;
+    mConfig.headless = nativeWindow == nullptr;
+    // The surface only ever shows the main view, skip the split view debug apparatus.
+    mConfig.debugViews = false;
     mConfig.iblDirectory = mAssetsPath + "/ibl/lightroom_14b";
 
     auto setup = [](void *data, Engine *engine, View *view, Scene *scene) {
-        auto app = reinterpret_cast<CompSurfContext *>(data)->mApp;
+        auto &app = reinterpret_cast<CompSurfContext *>(data)->mApp;
         auto& tcm = engine->getTransformManager();
         auto& rcm = engine->getRenderableManager();
         auto& em = utils::EntityManager::get();
 
+        // The engine exists, so BlueVK has resolved its entry points by now.
+        if (engine->getBackend() == Engine::Backend::VULKAN && !vulkan_loader::is_in_use()) {
+            std::cerr << "BlueVK's own loader is linked in, the host's Vulkan loader is ignored"
+                      << std::endl;
+        }
+
         // Instantiate material.
-        app.material = Material::Builder()
-                .package(RESOURCES_AIDEFAULTMAT_DATA, RESOURCES_AIDEFAULTMAT_SIZE).build(*engine);
-        auto mi = app.materialInstance = app.material->createInstance();
+        {
+            TraceRecorder::Scope trace("material build", "material");
+            app.material = Material::Builder()
+                    .package(RESOURCES_AIDEFAULTMAT_DATA, RESOURCES_AIDEFAULTMAT_SIZE).build(*engine);
+        }
+        {
+            TraceRecorder::Scope trace("material instance", "material");
+            app.materialInstance = app.material->createInstance();
+        }
+        auto mi = app.materialInstance;
         mi->setParameter("baseColor", RgbType::LINEAR, float3{0.8});
         mi->setParameter("metallic", 1.0f);
         mi->setParameter("roughness", 0.4f);
@@ -73,6 +97,10 @@ CompSurfContext::CompSurfContext(const char *accessToken,
         rcm.setCastShadows(rcm.getInstance(app.mesh.renderable), false);
         scene->addEntity(app.mesh.renderable);
 
+        // Spin around Y at one radian per second.
+        auto &animator = reinterpret_cast<CompSurfContext *>(data)->mFilamentApp.getAnimator();
+        animator.add(app.mesh.renderable, app.transform, float3{ 0, 1, 0 }, 1.0f);
+
         // Add light sources into the scene.
         app.light = em.create();
         LightManager::Builder(LightManager::Type::SUN)
@@ -86,35 +114,107 @@ CompSurfContext::CompSurfContext(const char *accessToken,
     };
 
     auto cleanup = [](void *data, Engine *engine, View *, Scene *) {
-        auto app = reinterpret_cast<CompSurfContext *>(data)->mApp;
+        auto &app = reinterpret_cast<CompSurfContext *>(data)->mApp;
         engine->destroy(app.light);
         engine->destroy(app.materialInstance);
         engine->destroy(app.mesh.renderable);
         engine->destroy(app.material);
     };
 
-    FilamentAppWayland::get().animate([](void *data, Engine *engine, View *view, double now) {
-        auto app = reinterpret_cast<CompSurfContext *>(data)->mApp;
-        auto& tcm = engine->getTransformManager();
-        auto ti = tcm.getInstance(app.mesh.renderable);
-        tcm.setTransform(ti, app.transform * mat4f::rotation(now, float3{ 0, 1, 0 }));
-    });
-
-    FilamentAppWayland::get().run(this, mConfig, width, height, setup, cleanup, nullptr, nullptr, nullptr);
+    if (async) {
+        mFilamentApp.runAsync(this, mConfig, width, height, setup, cleanup,
+                              [onReady = std::move(onReady)](void *) {
+                                  if (onReady) {
+                                      onReady();
+                                  }
+                              }, nullptr, nullptr, nullptr);
+    } else {
+        mFilamentApp.run(this, mConfig, width, height, setup, cleanup, nullptr, nullptr, nullptr);
+    }
 }
 
 void CompSurfContext::de_initialize() {
-    FilamentAppWayland::get().stop();
+    mFilamentApp.stop();
+    if (TraceRecorder::isEnabled()) {
+        write_trace(nullptr);
+    }
 }
 
-void CompSurfContext::run_task() {
+bool CompSurfContext::write_trace(const char *fileName) const {
+    const std::string name = fileName && *fileName ? fileName : "comp_surf_trace.json";
+    return TraceRecorder::write(mMiscPath + "/" + name);
+}
+
+size_t CompSurfContext::run_task(uint32_t budgetUs) {
+    return mFilamentApp.run_task(std::chrono::microseconds(budgetUs));
 }
 
 void CompSurfContext::resize(int width, int height) {
     mWidth = width;
     mHeight = height;
+    mFilamentApp.setWindowSize(width, height);
+}
+
+void CompSurfContext::set_frame_timing(float refreshRateHz, bool predictNextVsync) {
+    auto &clock = mFilamentApp.getFrameClock();
+    clock.setRefreshRate(refreshRateHz);
+    clock.setPrediction(predictNextVsync);
+}
+
+void CompSurfContext::get_stats(comp_surf_Stats *stats) const {
+    const FrameStats::Snapshot snapshot = mFilamentApp.getStats().read();
+
+    // version 1
+    stats->framesRendered = snapshot.framesRendered;
+    stats->framesSkipped = snapshot.framesSkipped;
+    stats->framesIdle = snapshot.framesIdle;
+    stats->framesEarly = snapshot.framesEarly;
+    stats->swapchainRecreations = snapshot.swapChainRecreations;
+    stats->lastFrameMs = snapshot.lastFrameMs;
+    stats->p50FrameMs = snapshot.p50FrameMs;
+    stats->p95FrameMs = snapshot.p95FrameMs;
+    stats->p99FrameMs = snapshot.p99FrameMs;
+    stats->entityCount = snapshot.entityCount;
+    stats->renderableCount = snapshot.renderableCount;
+    stats->drawCount = snapshot.drawCount;
+    stats->meshCpuBytes = snapshot.meshCpuBytes;
+    stats->meshGpuBytes = snapshot.meshGpuBytes;
+    stats->textureCpuBytes = snapshot.textureCpuBytes;
+    stats->textureGpuBytes = snapshot.textureGpuBytes;
+    stats->materialCpuBytes = snapshot.materialCpuBytes;
+    stats->materialGpuBytes = snapshot.materialGpuBytes;
+
+    if (stats->version >= 2) {
+        stats->framesPaced = snapshot.framesPaced;
+        stats->targetFrameMs = snapshot.targetFrameMs;
+    }
+    if (stats->version >= 3) {
+        stats->qualityLevel = snapshot.qualityLevel;
+        stats->temperature = snapshot.temperature;
+    }
+    if (stats->version >= 4) {
+        stats->updateMs = snapshot.updateMs;
+        stats->animationJobMs = snapshot.animationJobMs;
+        stats->manipulatorJobMs = snapshot.manipulatorJobMs;
+        stats->updateJobCount = snapshot.updateJobCount;
+    }
+    if (stats->version >= 5) {
+        stats->framesThrottled = snapshot.framesThrottled;
+    }
+}
+
+void CompSurfContext::get_phase_timing(PhaseTimings::Phase phase,
+                                       comp_surf_PhaseTiming *timing) const {
+    const PhaseTimings::Summary summary = mFilamentApp.getPhaseTimings().summary(phase);
+    timing->count = summary.count;
+    timing->minMs = summary.minMs;
+    timing->maxMs = summary.maxMs;
+    timing->meanMs = summary.meanMs;
+    timing->p50Ms = summary.p50Ms;
+    timing->p95Ms = summary.p95Ms;
+    timing->p99Ms = summary.p99Ms;
 }
 
 void CompSurfContext::draw_frame(uint32_t time) {
-    FilamentAppWayland::get().draw_frame(time);
+    mFrameSubmitted = mFilamentApp.draw_frame(time);
 }
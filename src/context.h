@@ -33,6 +33,7 @@
 #include <filamentappwayland/Config.h>
 #include <filamentappwayland/FilamentAppWayland.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -44,15 +45,23 @@ using Backend = Engine::Backend;
 
 struct CompSurfContext {
 public:
+    using ReadyCallback = std::function<void()>;
+
+    static constexpr uint32_t kDefaultTaskBudgetUs = 2000;
+
     static uint32_t version();
 
+    // When async is set the constructor returns right away, loading continues from
+    // run_task() and onReady is invoked from there once the first frame can be drawn.
     CompSurfContext(const char *accessToken,
                     int width,
                     int height,
                     void *nativeWindow,
                     const char *assetsPath,
                     const char *cachePath,
-                    const char *miscPath);
+                    const char *miscPath,
+                    bool async = false,
+                    ReadyCallback onReady = ReadyCallback());
 
     ~CompSurfContext() = default;
 
@@ -64,12 +73,59 @@ public:
 
     void de_initialize();
 
-    void run_task();
+    // Writes the recorded trace events into miscPath, see TraceRecorder. fileName may be null.
+    bool write_trace(const char *fileName) const;
+
+    // Runs queued background work for at most budgetUs, returns the number of tasks left.
+    size_t run_task(uint32_t budgetUs = kDefaultTaskBudgetUs);
 
     void draw_frame(uint32_t time);
 
+    // Whether the last draw_frame() submitted a new buffer; idle frames are elided.
+    [[nodiscard]] bool frame_submitted() const { return mFrameSubmitted; }
+
     void resize(int width, int height);
 
+    [[nodiscard]] bool is_ready() const { return mFilamentApp.isReady(); }
+
+    void set_frame_timing(float refreshRateHz, bool predictNextVsync);
+
+    void set_max_frame_rate(float fps) { mFilamentApp.setMaxFrameRate(fps); }
+
+    void set_performance_governor(bool enabled, float thermalLimit) {
+        mFilamentApp.setPerformanceGovernor(enabled, thermalLimit);
+    }
+
+    void set_frames_in_flight(bool lowLatency, uint32_t framesInFlight) {
+        mFilamentApp.setFramesInFlight(lowLatency ? FramePipeline::Mode::LOW_LATENCY
+                                                  : FramePipeline::Mode::HIGH_THROUGHPUT,
+                                       framesInFlight);
+    }
+
+    [[nodiscard]] size_t get_swapchain_recreation_count() const {
+        return mFilamentApp.getSwapChainRecreationCount();
+    }
+
+    // Lock free, safe to call from any thread.
+    void get_stats(comp_surf_Stats *stats) const;
+
+    // Lock free, safe to call from any thread.
+    void get_phase_timing(PhaseTimings::Phase phase, comp_surf_PhaseTiming *timing) const;
+
+    void reset_phase_timings() { mFilamentApp.getPhaseTimings().reset(); }
+
+    // Headless contexts (nativeWindow == nullptr) hand rendered frames over through a ring of
+    // readback buffers, see ReadbackRing.
+    void set_readback(uint32_t bufferCount, ReadbackRing::FrameCallback callback) {
+        mFilamentApp.setReadback(bufferCount, std::move(callback));
+    }
+
+    void release_frame(uint32_t index) {
+        if (auto *readback = mFilamentApp.getReadback()) {
+            readback->release(index);
+        }
+    }
+
 private:
     std::string mAccessToken;
     std::string mAssetsPath;
@@ -77,6 +133,7 @@ private:
     std::string mMiscPath;
     int mWidth;
     int mHeight;
+    bool mFrameSubmitted = false;
 
     struct App {
         utils::Entity light;
@@ -88,4 +145,8 @@ private:
 
     Config mConfig;
     App mApp;
+
+    // Each context owns its own window, swap chain, scene and views. The
+    // filament::Engine behind them is shared by all contexts in the process.
+    FilamentAppWayland mFilamentApp;
 };
@@ -16,6 +16,7 @@
 
 #include "../include/comp_surf_filament/comp_surf_filament.h"
 #include "context.h"
+#include "vulkan_loader.h"
 
 #include <cassert>
 #include <iostream>
@@ -57,8 +58,21 @@ uint32_t comp_surf_version() {
 API_EXPORT
 void comp_surf_load_functions(void *userdata,
                               comp_surf_LoaderFunction loaderFunction) {
-    (void) userdata;
-    (void) loaderFunction;
+    vulkan_loader::set_loader_function(userdata, loaderFunction);
+}
+
+API_EXPORT
+void comp_surf_set_tracing(uint32_t eventCapacity) {
+    if (eventCapacity) {
+        TraceRecorder::enable(eventCapacity);
+    } else {
+        TraceRecorder::disable();
+    }
+}
+
+API_EXPORT
+int comp_surf_write_trace(comp_surf_Context *ctx, const char *fileName) {
+    return getContext(ctx).write_trace(fileName) ? 0 : -1;
 }
 
 API_EXPORT
@@ -76,10 +90,67 @@ comp_surf_Context *comp_surf_initialize(const char *accessToken,
     return ctx;
 }
 
+API_EXPORT
+comp_surf_Context *comp_surf_initialize_async(const char *accessToken,
+                                              int width,
+                                              int height,
+                                              void *nativeWindow,
+                                              const char *assetsPath,
+                                              const char *cachePath,
+                                              const char *miscPath,
+                                              comp_surf_ReadyCallback callback,
+                                              void *userdata) {
+    auto *ctx = new comp_surf_Context;
+    ctx->context = std::make_unique<CompSurfContext>(accessToken, width, height,
+                                                     nativeWindow, assetsPath,
+                                                     cachePath, miscPath, true,
+                                                     [ctx, callback, userdata]() {
+                                                         if (callback) {
+                                                             callback(userdata, ctx);
+                                                         }
+                                                     });
+    return ctx;
+}
+
+API_EXPORT
+comp_surf_Context *comp_surf_initialize_headless(const char *accessToken,
+                                                 int width,
+                                                 int height,
+                                                 const char *assetsPath,
+                                                 const char *cachePath,
+                                                 const char *miscPath,
+                                                 uint32_t bufferCount,
+                                                 comp_surf_FrameCallback callback,
+                                                 void *userdata) {
+    auto *ctx = new comp_surf_Context;
+    ctx->context = std::make_unique<CompSurfContext>(accessToken, width, height,
+                                                     nullptr, assetsPath, cachePath,
+                                                     miscPath);
+    ctx->context->set_readback(
+            bufferCount,
+            [ctx, callback, userdata](uint32_t index, const void *pixels, uint32_t w,
+                                      uint32_t h, uint32_t stride) {
+                if (callback) {
+                    callback(userdata, ctx, index, pixels, w, h, stride);
+                }
+            });
+    return ctx;
+}
+
+API_EXPORT
+void comp_surf_release_frame(comp_surf_Context *ctx, uint32_t bufferIndex) {
+    getContext(ctx).release_frame(bufferIndex);
+}
+
+API_EXPORT
+int comp_surf_is_ready(comp_surf_Context *ctx) {
+    return getContext(ctx).is_ready() ? 1 : 0;
+}
+
 API_EXPORT
 void comp_surf_de_initialize(comp_surf_Context *ctx) {
     getContext(ctx).de_initialize();
-    ctx->context.release();
+    ctx->context.reset();
     delete ctx;
 }
 
@@ -88,12 +159,80 @@ void comp_surf_run_task(comp_surf_Context *ctx) {
     getContext(ctx).run_task();
 }
 
+API_EXPORT
+uint32_t comp_surf_run_task_budget(comp_surf_Context *ctx, uint32_t budgetUs) {
+    return static_cast<uint32_t>(getContext(ctx).run_task(budgetUs));
+}
+
 API_EXPORT
 void comp_surf_draw_frame(comp_surf_Context *ctx, uint32_t time) {
     getContext(ctx).draw_frame(time);
 }
 
+API_EXPORT
+int comp_surf_frame_submitted(comp_surf_Context *ctx) {
+    return getContext(ctx).frame_submitted() ? 1 : 0;
+}
+
+API_EXPORT
+void comp_surf_set_frame_timing(comp_surf_Context *ctx,
+                                float refreshRateHz,
+                                int predictNextVsync) {
+    getContext(ctx).set_frame_timing(refreshRateHz, predictNextVsync != 0);
+}
+
+API_EXPORT
+void comp_surf_set_max_frame_rate(comp_surf_Context *ctx, float fps) {
+    getContext(ctx).set_max_frame_rate(fps);
+}
+
+API_EXPORT
+void comp_surf_set_performance_governor(comp_surf_Context *ctx,
+                                        int enabled,
+                                        float thermalLimitCelsius) {
+    getContext(ctx).set_performance_governor(enabled != 0, thermalLimitCelsius);
+}
+
+API_EXPORT
+void comp_surf_set_frames_in_flight(comp_surf_Context *ctx,
+                                    comp_surf_PipelineMode mode,
+                                    uint32_t framesInFlight) {
+    getContext(ctx).set_frames_in_flight(mode == COMP_SURF_PIPELINE_LOW_LATENCY, framesInFlight);
+}
+
+API_EXPORT
+int comp_surf_get_phase_timing(comp_surf_Context *ctx,
+                               comp_surf_FramePhase phase,
+                               comp_surf_PhaseTiming *timing) {
+    static_assert(COMP_SURF_PHASE_COUNT == PhaseTimings::PHASE_COUNT,
+                  "comp_surf_FramePhase out of sync with PhaseTimings::Phase");
+    if (!timing || phase < 0 || phase >= COMP_SURF_PHASE_COUNT) {
+        return -1;
+    }
+    getContext(ctx).get_phase_timing(PhaseTimings::Phase(phase), timing);
+    return 0;
+}
+
+API_EXPORT
+void comp_surf_reset_phase_timings(comp_surf_Context *ctx) {
+    getContext(ctx).reset_phase_timings();
+}
+
 API_EXPORT
 void comp_surf_resize(comp_surf_Context *ctx, int width, int height) {
     getContext(ctx).resize(width, height);
 }
+
+API_EXPORT
+uint32_t comp_surf_get_swapchain_recreation_count(comp_surf_Context *ctx) {
+    return static_cast<uint32_t>(getContext(ctx).get_swapchain_recreation_count());
+}
+
+API_EXPORT
+int comp_surf_get_stats(comp_surf_Context *ctx, comp_surf_Stats *stats) {
+    if (!stats || stats->version == 0 || stats->version > COMP_SURF_STATS_VERSION) {
+        return -1;
+    }
+    getContext(ctx).get_stats(stats);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan_loader.h"
+
+#include <dlfcn.h>
+
+#include <atomic>
+#include <iostream>
+
+namespace {
+    std::atomic<void *> sHostInstanceProcAddr{nullptr};
+    void *sModule = nullptr;
+    std::atomic<bool> sInUse{false};
+}  // namespace
+
+namespace vulkan_loader {
+
+void set_loader_function(void *userdata, comp_surf_LoaderFunction loaderFunction) {
+    void *procAddr = nullptr;
+    if (loaderFunction) {
+        procAddr = const_cast<void *>(loaderFunction(userdata, "vkGetInstanceProcAddr"));
+        if (!procAddr) {
+            std::cerr << "Host loader doesn't provide vkGetInstanceProcAddr, "
+                         "falling back to libvulkan" << std::endl;
+        }
+    }
+    sHostInstanceProcAddr.store(procAddr, std::memory_order_release);
+}
+
+bool has_host_loader() {
+    return sHostInstanceProcAddr.load(std::memory_order_acquire) != nullptr;
+}
+
+bool is_in_use() {
+    return sInUse.load(std::memory_order_acquire);
+}
+
+}  // namespace vulkan_loader
+
+// These replace BlueVK's Linux implementation (BlueVKLinuxAndroid.cpp). Both
+// live in static archives, with these definitions linked first that object is
+// never pulled in. BlueVK::initialize() calls loadLibrary() followed by
+// getInstanceProcAddr(), then resolves everything else through the latter.
+namespace bluevk {
+
+bool loadLibrary() {
+    sInUse.store(true, std::memory_order_release);
+    if (vulkan_loader::has_host_loader()) {
+        return true;
+    }
+    if (!sModule) {
+        sModule = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+    }
+    if (!sModule) {
+        sModule = dlopen("libvulkan.so", RTLD_NOW | RTLD_LOCAL);
+    }
+    return sModule != nullptr;
+}
+
+void *getInstanceProcAddr() {
+    void *procAddr = sHostInstanceProcAddr.load(std::memory_order_acquire);
+    if (procAddr) {
+        return procAddr;
+    }
+    return sModule ? dlsym(sModule, "vkGetInstanceProcAddr") : nullptr;
+}
+
+}  // namespace bluevk
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2022 Toyota Connected North America
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "../include/comp_surf_filament/comp_surf_filament.h"
+
+// Vulkan entry points are resolved through BlueVK. By default it dlopen()s
+// libvulkan; once the host hands us its loader, vkGetInstanceProcAddr is taken
+// from there instead, so the plugin dispatches through the same loader (and
+// sees the same ICDs and layers) as the host. Must be called before the engine
+// is created, later calls only affect engines created afterwards.
+namespace vulkan_loader {
+
+void set_loader_function(void *userdata, comp_surf_LoaderFunction loaderFunction);
+
+[[nodiscard]] bool has_host_loader();
+
+// True once BlueVK loaded its entry points through the overrides below. Still
+// false after a Vulkan engine was created means BlueVK's own loader got linked
+// in instead, and the host's loader function is being ignored.
+[[nodiscard]] bool is_in_use();
+
+}  // namespace vulkan_loader
@@ -17,6 +17,7 @@
 #include "context.h"
 #include "vulkan/vulkan_wayland.h"
 #include "bluevk/BlueVK.h"
+#include "vulkan_loader.h"
 
 
 uint32_t CompSurfContext::version() {
@@ -695,10 +696,14 @@ bool CompSurfContext::createNewSwapchainThings(int w, int h) {
 }
 
 void CompSurfContext::initVulkan(void *native_window, int w, int h) {
+    // resolves through the host's loader when comp_surf_load_functions provided one
     if (!bluevk::initialize()) {
         utils::slog.e << "BlueVK is unable to load entry points.\n";
         quit(2);
     }
+    if (!vulkan_loader::is_in_use()) {
+        utils::slog.e << "BlueVK's own loader is linked in, the host's Vulkan loader is ignored.\n";
+    }
     createInstance();
     bluevk::bindInstance(gVulkanDriver.instance);
     createSurface(native_window);
@@ -16,6 +16,7 @@
 
 #include "../include/comp_surf_filament/comp_surf_filament.h"
 #include "context.h"
+#include "vulkan_loader.h"
 
 #include <cassert>
 #include <iostream>
@@ -57,8 +58,7 @@ uint32_t comp_surf_version() {
 API_EXPORT
 void comp_surf_load_functions(void *userdata,
                               comp_surf_LoaderFunction loaderFunction) {
-    (void) userdata;
-    (void) loaderFunction;
+    vulkan_loader::set_loader_function(userdata, loaderFunction);
 }
 
 API_EXPORT